@@ -0,0 +1,207 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2018 Steven T Sell (ssell@vertexfragment.com)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "earClipping_Core.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+//------------------------------------------------------------------------------------------
+
+namespace EarClipping
+{
+	/// Number of polygons a thread claims at a time
+	const unsigned BATCH_CHUNK_SIZE = 32;
+
+	/**
+	 * \brief Where the output of a single polygon was left by the thread that processed it.
+	 */
+	struct BatchSlot
+	{
+		unsigned worker;
+		size_t   firstVertex;		// in X,Y pairs
+		size_t   firstIndex;
+		uint32_t numVertices;
+		uint32_t numIndices;
+	};
+
+	/**
+	 * \brief Per-thread output. Each thread appends to its own buffers, which are gathered in input order once all threads are done.
+	 */
+	struct BatchWorker
+	{
+		std::vector< Scalar > vertices;
+		std::vector< uint32_t > indices;
+	};
+
+	/**
+	 * \brief State shared by all threads of a batch.
+	 */
+	struct BatchJob
+	{
+		Polygon* const* polygons;
+		unsigned numPolygons;
+
+		const TriangulationSettings* settings;
+
+		std::atomic< unsigned > nextPolygon;	// first polygon of the next unclaimed chunk
+
+		std::vector< BatchSlot > slots;			// one per polygon
+		std::vector< BatchWorker > workers;		// one per thread
+	};
+
+	//--------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Claims chunks of the batch until none are left, running the full pipeline on each polygon.
+	 */
+	void runBatchWorker( BatchJob* job, unsigned workerIndex )
+	{
+		BatchWorker &worker = job->workers[ workerIndex ];
+
+		std::vector< Scalar > vertices;
+		std::vector< uint32_t > indices;
+
+		while( true )
+		{
+			unsigned first = job->nextPolygon.fetch_add( BATCH_CHUNK_SIZE );
+
+			if( first >= job->numPolygons )
+				break;
+
+			unsigned last = std::min( first + BATCH_CHUNK_SIZE, job->numPolygons );
+
+			for( unsigned i = first; i < last; i++ )
+			{
+				Polygon* poly = job->polygons[ i ];
+				BatchSlot &slot = job->slots[ i ];
+
+				vertices.clear( );
+				indices.clear( );
+
+				if( ( poly != NULL ) && ( poly->numPoints( ) >= 3 ) )
+				{
+					orientatePolygon( poly );
+
+					// The batch already keeps every thread busy
+					if( poly->numChildren( ) > 0 )
+						mergePolygon( *poly, BRIDGE_CLOSEST, 1 );
+
+					triangulate( *poly, vertices, indices, *job->settings );
+				}
+
+				slot.worker = workerIndex;
+				slot.firstVertex = worker.vertices.size( ) / 2;
+				slot.firstIndex = worker.indices.size( );
+				slot.numVertices = vertices.size( ) / 2;
+				slot.numIndices = indices.size( );
+
+				worker.vertices.insert( worker.vertices.end( ), vertices.begin( ), vertices.end( ) );
+				worker.indices.insert( worker.indices.end( ), indices.begin( ), indices.end( ) );
+			}
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	unsigned triangulateBatch( Polygon* const* polygons, unsigned numPolygons,
+		                       std::vector< Scalar > &vertices, std::vector< uint32_t > &indices, std::vector< BatchRange > &ranges,
+		                       unsigned numThreads, const TriangulationSettings &settings )
+	{
+		vertices.clear( );
+		indices.clear( );
+		ranges.clear( );
+
+		if( numPolygons == 0 )
+			return 0;
+
+		if( numThreads == 0 )
+			numThreads = std::max( std::thread::hardware_concurrency( ), 1u );
+
+		// No point in starting threads that would find nothing left to claim
+		numThreads = std::min( numThreads, ( numPolygons + BATCH_CHUNK_SIZE - 1 ) / BATCH_CHUNK_SIZE );
+
+		BatchJob job;
+
+		job.polygons = polygons;
+		job.numPolygons = numPolygons;
+		job.settings = &settings;
+		job.nextPolygon = 0;
+		job.slots.resize( numPolygons );
+		job.workers.resize( numThreads );
+
+		//--------------------------------------------
+		// The calling thread acts as the first worker
+
+		std::vector< std::thread > threads;
+
+		for( unsigned i = 1; i < numThreads; i++ )
+			threads.push_back( std::thread( runBatchWorker, &job, i ) );
+
+		runBatchWorker( &job, 0 );
+
+		for( unsigned i = 0; i < threads.size( ); i++ )
+			threads[ i ].join( );
+
+		//--------------------------------------------
+		// Lay the results out in input order
+
+		ranges.resize( numPolygons );
+
+		uint32_t totalVertices = 0;
+		uint32_t totalIndices = 0;
+
+		for( unsigned i = 0; i < numPolygons; i++ )
+		{
+			ranges[ i ].firstVertex = totalVertices;
+			ranges[ i ].numVertices = job.slots[ i ].numVertices;
+			ranges[ i ].firstIndex = totalIndices;
+			ranges[ i ].numIndices = job.slots[ i ].numIndices;
+
+			totalVertices += job.slots[ i ].numVertices;
+			totalIndices += job.slots[ i ].numIndices;
+		}
+
+		vertices.resize( totalVertices * 2 );
+		indices.resize( totalIndices );
+
+		for( unsigned i = 0; i < numPolygons; i++ )
+		{
+			const BatchSlot &slot = job.slots[ i ];
+			const BatchWorker &worker = job.workers[ slot.worker ];
+
+			std::copy( worker.vertices.begin( ) + ( slot.firstVertex * 2 ),
+				       worker.vertices.begin( ) + ( ( slot.firstVertex + slot.numVertices ) * 2 ),
+				       vertices.begin( ) + ( ranges[ i ].firstVertex * 2 ) );
+
+			// Indices are rebased from the polygon onto the shared vertex buffer
+			for( uint32_t j = 0; j < slot.numIndices; j++ )
+				indices[ ranges[ i ].firstIndex + j ] = worker.indices[ slot.firstIndex + j ] + ranges[ i ].firstVertex;
+		}
+
+		return totalIndices / 3;
+	}
+}
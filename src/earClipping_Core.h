@@ -28,6 +28,7 @@
 //------------------------------------------------------------------------------------------
 
 #include <utility>
+#include <stdint.h>
 
 #include "earClipping_Structures.h"
 
@@ -48,14 +49,21 @@ namespace EarClipping
 	/// Ensures all polygons are in counter-clockwise order
 	void orientatePolygon( Polygon* poly );
 
+	/// How mergePolygon finds the points that connect a hole to the outer polygon
+	enum BridgeMode
+	{
+		BRIDGE_CLOSEST,				///< Closest mutually visible point, tested against every edge
+		BRIDGE_RAY_CAST				///< Nearest edge to the left of the hole (Eberly)
+	};
+
     /**
         When mergePolygon is called on a Polygon, the children are added to the parent.
 
             1. Order inner polygons by farthest (leftward) x-values
-            2. Take first Polygon and order it's points (this employs pointCompare( ))
+            2. Take first Polygon and order it's points (this employs PointCompare)
             3. Find the closest, mutually visible points of the exterior and interior polygons
             4. Ensure the diagonal created by these two points does not intersect any other lines
-            5. Add the points of the child to that of the parent
+            5. Move the points of the child to the parent in one splice (copied if their pools differ)
 
                 ex:
 
@@ -75,20 +83,408 @@ namespace EarClipping
 
                     note that the Exterior points remain ccw, while the added interior are cw.
 
-            6. Remove child Polygon from container
+            6. The child Polygon is left in the container, but empty
             7. If there exists another child, repeat from step [2]
+
+        With BRIDGE_RAY_CAST, steps 2-4 are replaced by casting a ray left from the leftmost
+        point of each hole to the nearest visible point, searched for on a grid of the edges.
+        This scales to polygons with thousands of holes. Holes lying outside are not merged.
+
+        With BRIDGE_CLOSEST and many children, steps 2-4 are first run for every child at once
+        across numThreads threads (0 for one per core), as though the children before it were
+        already merged. Each bridge found is then checked against the polygon as actually merged,
+        and searched for again only if it is no longer visible.
     **/
-    void mergePolygon( Polygon &poly );
+    void mergePolygon( Polygon &poly, BridgeMode mode = BRIDGE_CLOSEST, unsigned numThreads = 0 );
+
+    //--------------------------------------------------------------------------------------
+    // Polygon Preprocessing
+    // source: earClipping_Preprocess.cpp
+
+	/**
+	 * \struct PreprocessStats
+	 * \brief What preprocessPolygon found and changed.
+	 */
+	struct PreprocessStats
+	{
+		PreprocessStats( );
+
+		unsigned numRings;			///< Non-empty rings visited; the polygon and its children
+		unsigned numReversed;		///< Rings that were clockwise and have been reversed
+		unsigned numWelded;			///< Points removed as duplicates of the Point before them
+		unsigned numCollinear;		///< Points removed for lying in line with their neighbours
+		unsigned numDegenerate;		///< Rings left with fewer than three Points
+
+		double minX, minY;			///< Bounds of all rings, as given
+		double maxX, maxY;
+	};
+
+	/**
+	 * Prepares a polygon and its children for merging and triangulation in a single pass
+	 * over each ring. Points within weldEpsilon of the Point before them on both axes are
+	 * welded into it (0 welds exact duplicates only), and Points lying in line with their
+	 * neighbours are removed if removeCollinear is set. The signed area is summed in double
+	 * precision and the ring reversed if it runs clockwise, as orientatePolygon does, and
+	 * the bounds of all rings are gathered along the way.
+	 *
+	 * Every Point removed here is one less for the ear search to step over.
+	 */
+	PreprocessStats preprocessPolygon( Polygon* poly, double weldEpsilon = 0, bool removeCollinear = true );
 
     //--------------------------------------------------------------------------------------
     // Polygon Triangulation
+    // source: earClipping_Triangulation.cpp
+
+	/// Algorithm used by triangulate
+	enum TriangulationMethod
+	{
+		METHOD_EAR_CLIPPING,		///< Clips ears off the merged polygon. Quadratic in the worst case.
+		METHOD_MONOTONE				///< Sweep-line decomposition into y-monotone pieces. O(n log n).
+	};
+
+	/**
+	 * \struct TriangulationSettings
+	 * \brief Tuning options for triangulate. The defaults suit most polygons.
+	 */
+	struct TriangulationSettings
+	{
+		TriangulationSettings( )
+			: method( METHOD_EAR_CLIPPING ), zOrderThreshold( 1024 ) { }
+
+		TriangulationMethod method;
+
+		/**
+		 * Polygons with at least this many points hash their vertices onto a Morton (z-order)
+		 * curve over the bounding box, so each ear test only visits the points near the ear.
+		 * Smaller polygons are cheaper to scan directly. 0 disables the index.
+		 */
+		unsigned zOrderThreshold;
+	};
+
+	/**
+	 * Triangulates the polygon in memory. The polygon itself is left untouched.
+	 *
+	 * The points of the polygon are written to vertices as X,Y pairs (in list order, starting
+	 * at the head) and every three entries of indices reference the vertices of a single ear.
+	 * Both containers are cleared first. Returns the number of ears found; a complete
+	 * triangulation of an n-point polygon has n-2 ears.
+	 *
+	 * Any holes must have been merged in already; children are ignored. The method in the
+	 * settings selects the algorithm, and either produces the same output format.
+	 *
+	 * Strictly convex polygons are detected in one pass over the copied points and emitted
+	 * as a fan around the head in linear time, whichever method is selected.
+	 */
+	unsigned triangulate( const Polygon &poly, std::vector< Scalar > &vertices, std::vector< uint32_t > &indices,
+		                  const TriangulationSettings &settings = TriangulationSettings( ) );
+
+	/**
+	 * Triangulates the rings in vertices (X,Y pairs) by decomposing them into y-monotone
+	 * pieces, each of which is triangulated in linear time. ringStarts holds the first point
+	 * of each ring: the first ring is the outer boundary and any others are holes. Rings may
+	 * run in either direction. The sweep assumes simple rings, so the result is checked: every
+	 * triangle must be counter-clockwise and together they must cover the polygon's area.
+	 * Indices are cleared first; returns the number of triangles, or 0 if the sweep or the
+	 * check failed on self-intersecting or otherwise degenerate input.
+	 * source: earClipping_Monotone.cpp
+	 */
+	unsigned triangulateMonotone( const std::vector< Scalar > &vertices, const std::vector< uint32_t > &ringStarts, std::vector< uint32_t > &indices );
+
+	/// Largest ring handled by triangulateSmall
+	const unsigned SMALL_POLYGON_MAX_POINTS = 8;
+
+	/**
+	 * Triangulates a ring of 3 to SMALL_POLYGON_MAX_POINTS counter-clockwise points, given as
+	 * X,Y pairs in vertices, without allocating. Each size has its own kernel, unrolled at
+	 * compile time and working on a fixed array on the stack. indices must have room for
+	 * ( numPoints - 2 ) * 3 entries. Returns the number of ears written; 0 for any other size.
+	 * triangulate calls this itself for rings this small.
+	 * source: earClipping_Small.cpp
+	 */
+	unsigned triangulateSmall( const Scalar* vertices, unsigned numPoints, uint32_t* indices );
+
+	/**
+	 * Merges any holes into the polygon (in place, as mergePolygon does) and triangulates it
+	 * into an indexed mesh over the source vertices. vertices receives every point once: those
+	 * of the polygon, then those of each child in turn, as they were before merging. indices
+	 * reference that order, and the points duplicated for the bridges to the holes are mapped
+	 * back to the points they were copied from. Points repeated in the input are all mapped
+	 * to the first of them. Returns the number of ears found.
+	 *
+	 * The uint16_t version returns 0, with both containers empty, if there are more than
+	 * 65536 source points.
+	 */
+	unsigned triangulateIndexed( Polygon &poly, std::vector< Scalar > &vertices, std::vector< uint32_t > &indices,
+		                         BridgeMode mode = BRIDGE_CLOSEST, const TriangulationSettings &settings = TriangulationSettings( ) );
+	unsigned triangulateIndexed( Polygon &poly, std::vector< Scalar > &vertices, std::vector< uint16_t > &indices,
+		                         BridgeMode mode = BRIDGE_CLOSEST, const TriangulationSettings &settings = TriangulationSettings( ) );
+
+	/**
+	 * \class EarSink
+	 * \brief Receives the ears found by streamEars as they are clipped.
+	 */
+	class EarSink
+	{
+
+	public:
+
+		virtual ~EarSink( ) { }
+
+		/// Called once, before any ears, with the X,Y pairs the indices refer to. They stay valid until streamEars returns.
+		virtual void beginEars( const Scalar* /*vertices*/, unsigned /*numVertices*/ ) { }
+
+		/// Called with each batch of ears; three indices per ear. The indices are only valid during the call.
+		virtual void receiveEars( const uint32_t* indices, unsigned numEars ) = 0;
+
+	};
+
+	/**
+	 * Triangulates the polygon as triangulate does, but hands the ears to sink in batches of
+	 * batchSize as the triangulation goes, instead of returning them all at the end. The
+	 * first batch can be uploaded or processed while the rest of the polygon is clipped, and
+	 * only a single batch of indices is held at a time. Ear clipping delivers each batch as
+	 * soon as it is complete; the convex, small-polygon and monotone paths find all of their
+	 * ears at once and then deliver them in batches. Returns the number of ears found.
+	 */
+	unsigned streamEars( const Polygon &poly, EarSink &sink, unsigned batchSize = 256,
+		                 const TriangulationSettings &settings = TriangulationSettings( ) );
+
+	/// File formats recordEars can write
+	enum EarFileFormat
+	{
+		EAR_FILE_TEXT,				///< Ear count, then one X1,Y1:X2,Y2:X3,Y3 line per ear. Read by retrieveEars.
+		EAR_FILE_BINARY				///< Mesh file, as written by writeMesh. Read by MeshFile.
+	};
 
 	/// Triangulates the polygon and records the Ears in the specified path. Returns false on any critical errors.
-	bool recordEars( Polygon poly, const char* path );
+	bool recordEars( const Polygon &poly, const char* path, EarFileFormat format = EAR_FILE_TEXT );
 
 	//--------------------------------------------------------------------------------------
 
 	std::vector< float > retrieveEars( char* path );
+
+	/**
+	 * Reads a file written by recordEars in the text format, in place of retrieveEars. The
+	 * file is mapped into memory, split into runs of whole lines and parsed across numThreads
+	 * threads (0 for one per core; small files use fewer) straight into ears, sized from the
+	 * count on the first line. Every three X,Y pairs form an ear; blank lines are skipped.
+	 *
+	 * The line number (counting the header as 1) of every malformed line, and of any ear
+	 * beyond the count, is added to badLines; the ear for a malformed line is left as zeros.
+	 * If the file holds fewer ears than the count, ears is shortened to those read. Returns
+	 * true only if the whole file was read without error.
+	 * source: earClipping_ReadIn.cpp
+	 */
+	bool readEars( const char* path, std::vector< float > &ears, std::vector< unsigned > &badLines, unsigned numThreads = 0 );
+
+    //--------------------------------------------------------------------------------------
+    // Batch Triangulation
+    // source: earClipping_Batch.cpp
+
+	/**
+	 * \struct BatchRange
+	 * \brief Location of the output of a single polygon within the shared batch buffers.
+	 */
+	struct BatchRange
+	{
+		uint32_t firstVertex;		///< First X,Y pair of the polygon in the vertex buffer
+		uint32_t numVertices;
+		uint32_t firstIndex;		///< First entry of the polygon in the index buffer
+		uint32_t numIndices;		///< Three per ear
+	};
+
+	/**
+	 * Runs orientatePolygon, mergePolygon and triangulate on every polygon of the batch,
+	 * spread across numThreads threads (0 uses one per hardware thread). Polygons are
+	 * handed out in small chunks as threads become free, so uneven polygon sizes do not
+	 * leave threads idle.
+	 *
+	 * The polygons are oriented and merged in place, as when the steps are called one at a
+	 * time. Polygons sharing a PointPool must not be placed in the same batch, as the pool
+	 * is not synchronised.
+	 *
+	 * All results are written to vertices and indices, one after the other in input order,
+	 * with ranges[ i ] locating the output of polygons[ i ]. The indices reference the
+	 * shared vertex buffer, so the whole batch can be drawn at once. The containers are
+	 * cleared first. Returns the total number of ears found.
+	 */
+	unsigned triangulateBatch( Polygon* const* polygons, unsigned numPolygons,
+		                       std::vector< Scalar > &vertices, std::vector< uint32_t > &indices, std::vector< BatchRange > &ranges,
+		                       unsigned numThreads = 0, const TriangulationSettings &settings = TriangulationSettings( ) );
+
+    //--------------------------------------------------------------------------------------
+    // Ear Writer
+    // source: earClipping_Writer.cpp
+
+	struct EarWriterState;
+
+	/**
+	 * \class EarWriter
+	 * \brief Writes ears in the text format of recordEars, in the background.
+	 *
+	 * Values are formatted (with std::to_chars where available) into a large buffer. Each
+	 * full buffer is handed to a thread of the writer's own that writes it out while the next
+	 * one is filled, so the caller only waits when it gets a whole buffer ahead of the disk.
+	 * The file is flushed once, by close.
+	 */
+	class EarWriter
+	{
+
+	public:
+
+		/// bufferSize is the size in bytes of each of the two buffers
+		EarWriter( size_t bufferSize = 1 << 20 );
+
+		/// Closes the file
+		~EarWriter( );
+
+		/// Creates the file at path and starts the writing thread. Returns false if the file can not be created.
+		bool open( const char* path );
+
+		/// Writes the ear count line that starts the file
+		void writeCount( unsigned count );
+
+		/// Writes the ear abc, each an X,Y pair
+		void writeEar( const Scalar* a, const Scalar* b, const Scalar* c );
+
+		/// Writes out what is left, waits for the writing thread and closes the file. Returns false if any write failed.
+		bool close( );
+
+		/// Number of ears written since the file was opened
+		inline unsigned numEars( ) const { return m_NumEars; }
+
+	private:
+
+		// Not copyable; the thread and file are owned by the writer
+		EarWriter( const EarWriter& );
+		EarWriter& operator=( const EarWriter& );
+
+		/// Hands the filled buffer to the writing thread once there is no longer room for another ear
+		void reserve( );
+
+		EarWriterState* m_State;
+
+		char* m_Buffer;
+		size_t m_BufferSize;
+		size_t m_Used;
+
+		unsigned m_NumEars;
+
+	};
+
+    //--------------------------------------------------------------------------------------
+    // Mesh Files
+    // source: earClipping_Mesh.cpp
+
+	const uint32_t MESH_FILE_VERSION = 1;
+
+	/// Both blocks of a mesh file start on a multiple of this many bytes
+	const uint32_t MESH_FILE_ALIGNMENT = 16;
+
+	/// Coordinate type stored in a mesh file
+	enum MeshScalarType
+	{
+		MESH_SCALAR_FLOAT = 0,
+		MESH_SCALAR_DOUBLE = 1,
+		MESH_SCALAR_INT32 = 2
+	};
+
+	/**
+	 * \struct MeshFileHeader
+	 * \brief Start of a binary mesh file. All values are in the byte order of the machine that wrote it.
+	 *
+	 * The header is followed by the vertex block (numVertices X,Y pairs of the scalar type)
+	 * and the index block (numIndices uint32 values, three per ear), each starting at its
+	 * offset from the beginning of the file.
+	 */
+	struct MeshFileHeader
+	{
+		char magic[ 4 ];			///< "ECMS"
+		uint32_t version;			///< MESH_FILE_VERSION
+		uint32_t scalarType;		///< MeshScalarType
+		uint32_t scalarSize;		///< Size of a single coordinate in bytes
+		uint32_t numVertices;
+		uint32_t numIndices;
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+	};
+
+	/**
+	 * Writes the output of triangulate to path as a binary mesh file. Returns false if the
+	 * file could not be written.
+	 */
+	bool writeMesh( const char* path, const std::vector< Scalar > &vertices, const std::vector< uint32_t > &indices );
+
+	/**
+	 * \class MappedFile
+	 * \brief A whole file, mapped read-only into memory.
+	 */
+	class MappedFile
+	{
+
+	public:
+
+		MappedFile( );
+
+		/// Unmaps the file
+		~MappedFile( );
+
+		/// Maps the file at path, closing any file already open. Returns false if it can not be mapped (including if it is empty).
+		bool open( const char* path );
+		void close( );
+
+		inline bool isOpen( ) const { return m_Data != NULL; }
+
+		inline const char* data( ) const { return m_Data; }
+		inline size_t size( ) const { return m_Size; }
+
+	private:
+
+		// Not copyable; the mapping is owned by the file
+		MappedFile( const MappedFile& );
+		MappedFile& operator=( const MappedFile& );
+
+		const char* m_Data;
+		size_t m_Size;
+
+	};
+
+	/**
+	 * \class MeshFile
+	 * \brief Read-only view of a binary mesh file, mapped into memory.
+	 *
+	 * Nothing is parsed or copied: vertices and indices point straight into the mapping and
+	 * stay valid until the file is closed. Only the header is checked on open, so the file
+	 * must have been written with the same coordinate type and byte order. Index values are
+	 * not checked against the number of vertices.
+	 */
+	class MeshFile
+	{
+
+	public:
+
+		/// Maps the file at path, closing any file already open. Returns false if it can not be mapped or is not a valid mesh file.
+		bool open( const char* path );
+		inline void close( ){ m_File.close( ); }
+
+		inline bool isOpen( ) const { return m_File.isOpen( ); }
+
+		uint32_t numVertices( ) const;
+		uint32_t numIndices( ) const;
+
+		/// X,Y pairs, numVertices of them
+		const Scalar* vertices( ) const;
+
+		/// Three per ear, numIndices of them
+		const uint32_t* indices( ) const;
+
+	private:
+
+		inline const MeshFileHeader* header( ) const { return reinterpret_cast< const MeshFileHeader* >( m_File.data( ) ); }
+
+		MappedFile m_File;
+
+	};
 }
 /*! @} End of Doxygen Groups*/
 
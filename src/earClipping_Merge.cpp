@@ -24,41 +24,68 @@
  
 #include "earClipping_Core.h"
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <thread>
 
 //------------------------------------------------------------------------------------------
 
 namespace EarClipping
 {
-	// Used in pointCompare called in orderPoints
-	// Can not directly pass it to the method
-	Point activePoint;
+	/// Fewest children for which mergePolygon searches for bridges on several threads
+	const unsigned MERGE_PARALLEL_CHILDREN = 64;
 
 	/**
 	 * \author ssell
 	 * \brief Used by the STL sorting algorithm while ordering from smallest x-value to greatest. Distance formula.
+	 *
+	 * Compares squared distances, which orders the same as the distances themselves.
+	 * The anchor is carried by the comparator so concurrent merges do not share any state.
 	 */
-    bool pointCompare( Point i, Point j )
-    {
-		return std::sqrt( ( ( ( i.x - activePoint.x ) * ( i.x - activePoint.x ) ) + ( ( i.y - activePoint.y ) * ( i.y - activePoint.y ) ) ) ) <
-               std::sqrt( ( ( ( j.x - activePoint.x ) * ( j.x - activePoint.x ) ) + ( ( j.y - activePoint.y ) * ( j.y - activePoint.y ) ) ) );
-    }
+	struct PointCompare
+	{
+		PointCompare( const Point &anchor )
+			: activePoint( anchor ) { }
+
+		bool operator()( Point i, Point j ) const
+		{
+			Point di = i - activePoint;
+			Point dj = j - activePoint;
+
+			return di.dot( di ) < dj.dot( dj );
+		}
+
+		bool operator()( const Point* i, const Point* j ) const
+		{
+			return ( *this )( *i, *j );
+		}
+
+		bool operator()( const std::pair< Point*, int > &i, const std::pair< Point*, int > &j ) const
+		{
+			return ( *this )( *i.first, *j.first );
+		}
+
+		Point activePoint;
+	};
 
 	//--------------------------------------------------------------------------------------
 
 	/**
 	 * \author ssell
 	 * \brief Ordered the points of the provided Polygon in order of least to greatest distance from param point.
+	 *
+	 * The points are written to pointContainer, which is reused between calls.
 	 */
-    std::vector< Point > orderPoints( Polygon &poly, Point point )
+    void orderPoints( Polygon &poly, Point point, std::vector< Point* > &pointContainer )
 	{
 		// Put points in poly into a vector
     
-		Point head = *poly.get( );
-
-		std::vector< Point > pointContainer;
+		Point* head = poly.get( );
 
-		activePoint = point;
+		pointContainer.clear( );
+		pointContainer.reserve( poly.numPoints( ) );
 
 		/**
 			Outer polygon may have duplicate points.
@@ -68,13 +95,11 @@ namespace EarClipping
 		for( unsigned i = 0; i < poly.numPoints( ); i++ )
 		{
 			pointContainer.push_back( head );
-			head = *head.next;
+			head = head->next;
 		}
 
 		// Sort the points
-		std::sort( pointContainer.begin( ), pointContainer.end( ), pointCompare );
-
-		return pointContainer;
+		std::sort( pointContainer.begin( ), pointContainer.end( ), PointCompare( point ) );
 	}
 
 
@@ -83,6 +108,9 @@ namespace EarClipping
 	/**
 	 * \author ssell
 	 * \brief Returns TRUE if the two line segments intersect, else returns FALSE
+	 *
+	 * The segment parameters t and u are compared as numerators against their shared
+	 * denominator, so no division takes place and integer coordinates are tested exactly.
 	 */
     bool doIntersect( Point a, Point b, Point c, Point d, bool endpoint_touch_is_intersection = false )
 	{
@@ -91,7 +119,9 @@ namespace EarClipping
 		Point q = c;
 		Point s = d - c;
 
-		if( r.cross( s ) == 0 )
+		WideScalar denominator = r.cross( s );
+
+		if( denominator == 0 )
 		{
 			if( ( q - p ).cross( r ) == 0 )
 				return true; // collinear (bad data set?)
@@ -99,23 +129,215 @@ namespace EarClipping
 			return false; // parallel
 		}
 
-		float t = ( q - p ).cross( s ) / r.cross( s );
-		float u = ( q - p ).cross( r ) / r.cross( s );
+		// t = tn / denominator, u = un / denominator
+		WideScalar tn = ( q - p ).cross( s );
+		WideScalar un = ( q - p ).cross( r );
+
+		if( denominator < 0 )
+		{
+			denominator = -denominator;
+			tn = -tn;
+			un = -un;
+		}
 
 		// u == 0 || u == 1, endpoints touch
-		if( t >= 0 && t <= 1 )
+		if( tn >= 0 && tn <= denominator )
 		{
-			if( (  endpoint_touch_is_intersection && u >= 0 && u <= 1 ) || 
-				( !endpoint_touch_is_intersection && u >  0 && u <  1 ) )
+			if( (  endpoint_touch_is_intersection && un >= 0 && un <= denominator ) || 
+				( !endpoint_touch_is_intersection && un >  0 && un <  denominator ) )
 				return true;
 		}
 
-		if( t >= 0 && t <= 1 && u > 0 && u < 1 )
+		if( tn >= 0 && tn <= denominator && un > 0 && un < denominator )
 			return true;
 
 		return false;
 	}
 
+	//--------------------------------------------------------------------------------------
+	// Edge grid
+
+	/**
+	 * \brief Uniform grid over the edges taking part in a merge.
+	 *
+	 * Used by both bridge modes, so visibility tests only look at the edges near a segment.
+	 * Each cell lists the edges whose bounding box overlaps it. An edge is recorded by its
+	 * start Point and runs to start->next. Entries are only ever added: when a splice changes
+	 * where a Point leads, it is entered again for its new edge. A cell may therefore list
+	 * edges that no longer cross it, which the tests simply reject.
+	 */
+	struct EdgeGrid
+	{
+		double minX, minY;
+		double cellSize;
+
+		int columns, rows;
+
+		std::vector< std::vector< Point* > > cells;
+
+		int column( double x ) const { return std::max( 0, std::min( columns - 1, static_cast< int >( ( x - minX ) / cellSize ) ) ); }
+		int row( double y ) const { return std::max( 0, std::min( rows - 1, static_cast< int >( ( y - minY ) / cellSize ) ) ); }
+
+		std::vector< Point* > &cell( int c, int r ) { return cells[ ( r * columns ) + c ]; }
+
+		void insert( Point* start );
+		bool crosses( Point* a, Point* b );
+	};
+
+	void EdgeGrid::insert( Point* start )
+	{
+		Point* end = start->next;
+
+		int c0 = column( std::min( start->x, end->x ) );
+		int c1 = column( std::max( start->x, end->x ) );
+		int r0 = row( std::min( start->y, end->y ) );
+		int r1 = row( std::max( start->y, end->y ) );
+
+		for( int r = r0; r <= r1; r++ )
+			for( int c = c0; c <= c1; c++ )
+				cell( c, r ).push_back( start );
+	}
+
+	/**
+	 * \brief Returns TRUE if segment [a,b] is crossed or touched by one of the edges listed along it.
+	 *
+	 * Only the cells the segment passes through are visited, row by row.
+	 */
+	bool EdgeGrid::crosses( Point* a, Point* b )
+	{
+		double ax = a->x, ay = a->y;
+		double bx = b->x, by = b->y;
+
+		double lowY = std::min( ay, by );
+		double highY = std::max( ay, by );
+		double slack = cellSize * 1e-6;		// interpolated ends may round across a cell border
+
+		int r0 = row( lowY );
+		int r1 = row( highY );
+
+		for( int r = r0; r <= r1; r++ )
+		{
+			double x0 = std::min( ax, bx );
+			double x1 = std::max( ax, bx );
+
+			// Narrow to the part of the segment within this row
+			if( ay != by )
+			{
+				double y0 = std::max( lowY, minY + ( r * cellSize ) );
+				double y1 = std::min( highY, minY + ( ( r + 1 ) * cellSize ) );
+
+				double xa = ax + ( ( y0 - ay ) * ( bx - ax ) / ( by - ay ) );
+				double xb = ax + ( ( y1 - ay ) * ( bx - ax ) / ( by - ay ) );
+
+				x0 = std::max( x0, std::min( xa, xb ) );
+				x1 = std::min( x1, std::max( xa, xb ) );
+			}
+
+			int c0 = column( x0 - slack );
+			int c1 = column( x1 + slack );
+
+			for( int c = c0; c <= c1; c++ )
+			{
+				std::vector< Point* > &edges = cell( c, r );
+
+				for( unsigned i = 0; i < edges.size( ); i++ )
+				{
+					Point* c = edges[ i ];
+					Point* d = c->next;
+
+					// Edges meeting the segment at its own ends do not block it
+					if( ( *c == *a ) || ( *c == *b ) || ( *d == *a ) || ( *d == *b ) )
+						continue;
+
+					// Passing through a point of another edge does
+					if( doIntersect( *a, *b, *c, *d, true ) )
+						return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	 * \brief Sizes the grid over the bounding box of the polygon and its children, with roughly one cell per point.
+	 */
+	void initGrid( EdgeGrid &grid, Polygon &poly )
+	{
+		double maxX, maxY;
+		unsigned numPoints = 0;
+
+		grid.minX = maxX = poly.get( )->x;
+		grid.minY = maxY = poly.get( )->y;
+
+		for( int i = -1; i < static_cast< int >( poly.numChildren( ) ); i++ )
+		{
+			Polygon* ring = ( i < 0 ) ? &poly : poly.getChild( i );
+			Point* active = ring->get( );
+
+			if( active == NULL )
+				continue;
+
+			do
+			{
+				grid.minX = std::min( grid.minX, static_cast< double >( active->x ) );
+				grid.minY = std::min( grid.minY, static_cast< double >( active->y ) );
+				maxX = std::max( maxX, static_cast< double >( active->x ) );
+				maxY = std::max( maxY, static_cast< double >( active->y ) );
+
+				active = active->next;
+			} while( active != ring->get( ) );
+
+			numPoints += ring->numPoints( ) + 2;
+		}
+
+		double width = maxX - grid.minX;
+		double height = maxY - grid.minY;
+
+		// Square cells, numPoints of them over the box. Thin boxes fall back on one row or column.
+		grid.cellSize = std::max( std::sqrt( ( width * height ) / numPoints ), std::max( width, height ) / numPoints );
+
+		if( !( grid.cellSize > 0 ) )
+			grid.cellSize = 1;
+
+		grid.columns = static_cast< int >( width / grid.cellSize ) + 1;
+		grid.rows = static_cast< int >( height / grid.cellSize ) + 1;
+
+		grid.cells.resize( grid.columns * grid.rows );
+	}
+
+	// area, inCorner and locallyInside are adapted from earcut (see the notice under Ray cast bridging)
+
+	/// Twice the signed area of the triangle; negative if p, q, r turn counter-clockwise
+	double area( const Point* p, const Point* q, const Point* r )
+	{
+		return ( ( static_cast< double >( q->y ) - p->y ) * ( static_cast< double >( r->x ) - q->x ) ) -
+		       ( ( static_cast< double >( q->x ) - p->x ) * ( static_cast< double >( r->y ) - q->y ) );
+	}
+
+	/// Returns true if the diagonal from a towards b starts off inside the corner previous, a, next
+	bool inCorner( const Point* previous, const Point* a, const Point* next, const Point* b )
+	{
+		if( area( previous, a, next ) < 0 )
+			return ( area( a, b, next ) >= 0 ) && ( area( a, previous, b ) >= 0 );
+
+		return ( area( a, b, previous ) < 0 ) || ( area( a, next, b ) < 0 );
+	}
+
+	/// Returns true if the diagonal from a towards b starts off inside the polygon
+	bool locallyInside( const Point* a, const Point* b )
+	{
+		return inCorner( a->previous, a, a->next, b );
+	}
+
+	/**
+	 * \brief Returns TRUE if segment [a,b] may connect a hole Point a to the polygon Point b.
+	 */
+	bool isVisible( EdgeGrid &grid, Point* a, Point* b )
+	{
+		return locallyInside( b, a ) && !grid.crosses( a, b );
+	}
+
 	//--------------------------------------------------------------------------------------
 
 	/**
@@ -123,23 +345,20 @@ namespace EarClipping
 	 * \brief Returns the two closest points of the specified Polygons.
 	 *
 	 * Finds the Point that belongs to the Outer Polygon that is closest to the specified inner point. 
+	 * Returns NULL if none of the points is visible.
 	 *
 	 * \param $first
-	 *	"@param" is the points of the outer polygon, ordered from smallest-x to greatest.
+	 *	"@param" is the points of the outer polygon, ordered from nearest to farthest.
 	 * \param $second
 	 *	The index of the ordered points at which to begin checking.
 	 * \param $third
-	 *	Outer (parent) Polygon
+	 *	Grid holding the edges of the outer polygon and of every child.
 	 * \param $fourth
 	 *	The Point with the smallest x-value of the inner polygon.
 	 */
-    Point getClosest( std::vector< Point > pointsOrdered, int index, Polygon* poly, Point innerPoint )
+    Point* getClosest( const std::vector< Point* > &pointsOrdered, unsigned index, EdgeGrid &grid, Point* innerPoint )
     {
-		Point a = innerPoint;
-		Point b = pointsOrdered[ index ];
-		Point* c = poly->get( );
-
-		bool intersection = false;
+		Point* a = innerPoint;
 
 		//--------------------------------------------
 
@@ -148,107 +367,169 @@ namespace EarClipping
 			farthest 'left' point of the inner polygon
 			and the 'closest' point on the outer polygon.
 
-			Segment AB is then compared to each segment
-			of the outer polygon to make sure that the
-			segment C,C+1 does not block the LOS of the
-			points A and B.
+			Segment AB is then compared to the edges
+			near it, both of the outer polygon and of
+			the children, to make sure that none of
+			them block the LOS of the points A and B.
 
-			If the segments intersect then it is checked
-			if AB is intersected by the next segments of
-			the outer polygon.
-		*/
-		do
-		{
-			//Does segment [a,b] intersect with [c,c.next]?
-			intersection = doIntersect( a, b, *c, *c->next );
-			c = c->next;
-		} while( ( intersection == false ) && ( c != poly->get( ) ) );
+			B may appear more than once in the outer
+			polygon once holes are merged, so A also
+			has to lie within the corner at this B.
 
-		if( !intersection )
+			If somehow a segment intersects with AB then 
+			we move B on to the next closest point on the outer polygon.
+		*/
+		for( ; index < pointsOrdered.size( ); index++ )
 		{
-			c = &a;
-
-			// Make sure [a,b] does not intersect any points of the inner polygon now
-			do
-			{
-				intersection = doIntersect( a, b, *c, *c->next );
-				c = c->next;
-			} while( ( intersection == false ) && ( c->x != a.x && c->y != a.y ) );
+			Point* b = pointsOrdered[ index ];
 
-			// no intersection anywhere. b is valid
-			if( !intersection )
+			if( isVisible( grid, a, b ) )
 				return b;
 		}
 
-		/*
-			Return b if intersection is false, else if somehow
-			segment of the outer polygon intersects with AB then 
-			we will increment B to the next closest point on the outer polygon.
-		*/
-		return getClosest( pointsOrdered, index + 1, poly, innerPoint );
+		return NULL;
     }
 
 	//--------------------------------------------------------------------------------------
 
+	/**
+	 * \brief Returns the first Point of the Polygon with the given x-value.
+	 */
+	Point* findSmallest( Polygon &inner, Scalar smallestX )
+	{
+		Point* smallest = inner.get( );
+
+		do
+		{
+			if( smallest->x == smallestX )
+				break;
+
+			smallest = smallest->next;
+		} while( smallest != inner.get( ) );
+
+		return smallest;
+	}
+
 	/**
 	 * \author ssell
 	 * \brief Finds two, mutually visible Points for the outer (parent) and inner (child) Polygons.
 	 *
 	 * The line segment found by this function is the new line that will connect the outer and inner polygons.
 	 * It is what the merger of the two will based around.
+	 * ordered is scratch space for the sorted points of outer.
 	 */
-    std::pair< Point, Point > getSplit( Polygon &outer, Polygon &inner, int smallestX )
+    std::pair< Point*, Point* > getSplit( Polygon &outer, Polygon &inner, Scalar smallestX, EdgeGrid &grid, std::vector< Point* > &ordered )
     {
 		// 1. Get point from inner with X that matches smallestX
 		// 2. Find closest mutually visible point on outer to point found in step 1
 
-		std::pair< Point, Point > split;
+		std::pair< Point*, Point* > split;
 
-		Point* smallest = inner.get( );
+		Point* smallest = findSmallest( inner, smallestX );
+
+		// Have the point from inner with the smallest X value
+		orderPoints( outer, *smallest, ordered );
+
+		split.first = smallest;
+		split.second = getClosest( ordered, 0, grid, smallest );
+
+        return split;
+    }
+
+	//--------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Returns TRUE unless the ring the Point belongs to runs clockwise.
+	 */
+	bool isCounterClockwise( const Point &start )
+	{
+		double total = 0;
+		const Point* active = &start;
 
 		do
 		{
-			if( smallest->x == smallestX )
-				break;
+			total += ( static_cast< double >( active->next->x ) - active->x ) * ( static_cast< double >( active->next->y ) + active->y );
+			active = active->next;
+		} while( active != &start );
 
-			smallest = smallest->next;
-		} while( smallest != inner.get( ) );
+		return total <= 0;
+	}
 
-		// Have the point from inner with the smallest X value
-		Point closest = getClosest( orderPoints( outer, *smallest ), 0, &outer, *smallest );
+	/**
+	 * \brief Links the child into the polygon after bridge, which gains a copy of itself and of the hole Point.
+	 *
+	 *  Polygon: A, B, C      Hole: 1, 2, 3      Bridge: B - 1
+	 *  Merged:  A, B, 1, 3, 2, 1, B, C
+	 *
+	 * The child is turned clockwise, against the direction of the polygon, and its Points are
+	 * moved over in one splice, leaving it empty. They are only copied if the child uses a
+	 * different pool. Every new edge is entered into the grid.
+	 */
+	void spliceHole( Polygon &poly, Polygon &child, EdgeGrid &grid, Point* bridge, Point* hole )
+	{
+		if( isCounterClockwise( *hole ) )
+			child.reverse( -1 );
 
-		split.first = *smallest;
-		split.second = closest;
+		Point* active = hole;
+		Point* after = bridge->next;
 
-        return split;
-    }
+		if( !poly.splice( bridge, child, hole ) )
+		{
+			do
+			{
+				poly.insertBefore( after, active->x, active->y );
+				active = active->next;
+			} while( active != hole );
+		}
+
+		poly.insertBefore( after, hole->x, hole->y );
+		poly.insertBefore( after, bridge->x, bridge->y );
+
+		// The bridge now leads into the hole and the old edge leaves from its copy
+		for( active = bridge; active != after; active = active->next )
+			grid.insert( active );
+	}
+
+	/**
+	 * \brief Enters every edge of the Polygon into the grid.
+	 */
+	void insertEdges( EdgeGrid &grid, Polygon &poly )
+	{
+		Point* active = poly.get( );
+
+		if( active == NULL )
+			return;
+
+		do
+		{
+			grid.insert( active );
+			active = active->next;
+		} while( active != poly.get( ) );
+	}
 
 	//--------------------------------------------------------------------------------------
 
 	/**
 	 * \author ssell
-	 * \brief Recursive function to find the smallest x-value in a given Point-list
-	 * \param $second
-			For the initial call, head->next should be provided as the current Point
+	 * \brief Finds the smallest x-value in a given Point-list, walking it once from head
 	 */
-
-	int getSmallest( Point* head, Point* current, unsigned smallest )
+	Scalar getSmallest( Point* head )
 	{
-		// If the x of the current point is smaller, set smallest to it
-		smallest = current->x < smallest ? current->x : smallest;
-
-		// If we are at the head, the the whole list has been traversed
-		if( current->x == head->x )
-			return smallest;
-		else
-			getSmallest( head, current->next, smallest );
+		Scalar smallest = head->x;
+		Point* current = head->next;
+
+		// Once back at the head, the whole list has been traversed
+		for( ; current != head; current = current->next )
+			smallest = current->x < smallest ? current->x : smallest;
+
+		return smallest;
 	}
 
 	/**
 	 * \author ssell
 	 * \brief Sorts the provided pair. Used in child ordering. first = value, second = child #
 	 */
-	bool sortThem( std::pair< int, int > i, std::pair< int, int > j )
+	bool sortThem( const std::pair< int, Scalar > &i, const std::pair< int, Scalar > &j )
 	{
 		return i.second < j.second;
 	}
@@ -257,11 +538,11 @@ namespace EarClipping
 	 * \author ssell
 	 * \brief Orders the specified child Polygons in order of smallest x-value
 	 */
-	std::vector< std::pair< int, int > > childOrder( std::vector< Polygon* > children )
+	std::vector< std::pair< int, Scalar > > childOrder( const std::vector< Polygon* > &children )
 	{
 		int size = children.size( );
 
-		std::vector< std::pair< int, int > > toSort;		//child number, value
+		std::vector< std::pair< int, Scalar > > toSort;		//child number, value
 
 		//--------------------------------------------
 
@@ -272,7 +553,10 @@ namespace EarClipping
 		{
 			head = children[ i ]->get( );
 
-			toSort.push_back( std::pair< int, int >( i, getSmallest( head, head->next, head->x ) ) );
+			if( head == NULL )
+				continue;	// already merged
+
+			toSort.push_back( std::pair< int, Scalar >( i, getSmallest( head ) ) );
 		}
 
 		// Using a simple sort as this should not be the bottle-neck of the program.
@@ -295,13 +579,14 @@ namespace EarClipping
 
 		Point* active = poly->get( );
 
-		long total = 0;
+		// Summed in double; float products would be truncated by an integer total
+		double total = 0;
 
 		//--------------------------------------------
 		// First do parent
 		for( int i = 0; i < poly->numPoints( ); i++ )
 		{
-			total += ( active->next->x - active->x ) * ( active->next->y + active->y );
+			total += ( static_cast< double >( active->next->x ) - active->x ) * ( static_cast< double >( active->next->y ) + active->y );
 			active = active->next;
 		}
 
@@ -317,11 +602,11 @@ namespace EarClipping
 			total = 0;
 
 			if( active == NULL )
-				break;
+				continue;	// merged
 
 			for( int j = 0; j < poly->getChild( i )->numPoints( ); j++ )
 			{
-				total += ( active->next->x - active->x ) * ( active->next->y + active->y );
+				total += ( static_cast< double >( active->next->x ) - active->x ) * ( static_cast< double >( active->next->y ) + active->y );
 				active = active->next;
 			}
 
@@ -331,32 +616,390 @@ namespace EarClipping
 		}
 	}
 
+	//--------------------------------------------------------------------------------------
+	// Ray cast bridging
+	// source: http://www.geometrictools.com/Documentation/TriangulationByEarClipping.pdf
+	//
+	// pointInTriangle, sectorContainsSector, findBridge and mergeRayCast are adapted from
+	// eliminateHole, findHoleBridge, sectorContainsSector and pointInTriangle of earcut:
+	// https://github.com/mapbox/earcut
+	//
+	// ISC License
+	//
+	// Copyright (c) 2016, Mapbox
+	//
+	// Permission to use, copy, modify, and/or distribute this software for any purpose
+	// with or without fee is hereby granted, provided that the above copyright notice
+	// and this permission notice appear in all copies.
+	//
+	// THE SOFTWARE IS PROVIDED "AS IS" AND ISC DISCLAIMS ALL WARRANTIES WITH REGARD TO
+	// THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS.
+	// IN NO EVENT SHALL ISC BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR
+	// CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+	// OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACT,
+	// ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+	bool pointInTriangle( double ax, double ay, double bx, double by, double cx, double cy, double px, double py )
+	{
+		return ( ( cx - px ) * ( ay - py ) >= ( ax - px ) * ( cy - py ) ) &&
+		       ( ( ax - px ) * ( by - py ) >= ( bx - px ) * ( ay - py ) ) &&
+		       ( ( bx - px ) * ( cy - py ) >= ( cx - px ) * ( by - py ) );
+	}
+
+	/// Returns true if the wedge of the polygon at m contains the wedge at p. Separates coincident points.
+	bool sectorContainsSector( const Point* m, const Point* p )
+	{
+		return ( area( m->previous, m, p->previous ) < 0 ) && ( area( p->next, m, m->next ) < 0 );
+	}
+
+	/**
+	 * \brief Finds the Point of the polygon the leftmost Point of a hole is bridged to. NULL if the hole lies outside.
+	 *
+	 * A ray is cast left from the hole to the nearest edge of the polygon. The end of that
+	 * edge lying further left is visible unless a reflex Point lies inside the triangle
+	 * formed by the hole, the hit and that end; the one of those closest in angle to the ray
+	 * is visible instead.
+	 */
+	Point* findBridge( EdgeGrid &grid, const Point* hole )
+	{
+		double hx = hole->x;
+		double hy = hole->y;
+		double qx = -std::numeric_limits< double >::infinity( );
+
+		Point* bridge = NULL;
+
+		//--------------------------------------------
+		// Walk the cells left along the row of the ray until nothing further left can be nearer
+
+		int r = grid.row( hy );
+
+		for( int c = grid.column( hx ); c >= 0; c-- )
+		{
+			std::vector< Point* > &edges = grid.cell( c, r );
+
+			for( unsigned i = 0; i < edges.size( ); i++ )
+			{
+				Point* p = edges[ i ];
+				Point* n = p->next;
+
+				// Only edges running down face the ray with their inner side
+				if( ( hy <= p->y ) && ( hy >= n->y ) && ( n->y != p->y ) )
+				{
+					double x = p->x + ( ( hy - p->y ) * ( static_cast< double >( n->x ) - p->x ) / ( static_cast< double >( n->y ) - p->y ) );
+
+					if( ( x <= hx ) && ( x > qx ) )
+					{
+						qx = x;
+						bridge = ( p->x < n->x ) ? p : n;
+
+						if( x == hx )
+							return bridge;	// hole touches the edge
+					}
+				}
+			}
+
+			if( ( bridge != NULL ) && ( qx >= grid.minX + ( c * grid.cellSize ) ) )
+				break;
+		}
+
+		if( bridge == NULL )
+			return NULL;
+
+		//--------------------------------------------
+		// Look for reflex Points inside the triangle of hole, hit and edge end
+
+		double mx = bridge->x;
+		double my = bridge->y;
+		double tanMin = std::numeric_limits< double >::infinity( );
+
+		int c0 = grid.column( mx );
+		int c1 = grid.column( hx );
+		int r0 = grid.row( std::min( hy, my ) );
+		int r1 = grid.row( std::max( hy, my ) );
+
+		for( r = r0; r <= r1; r++ )
+		{
+			for( int c = c0; c <= c1; c++ )
+			{
+				std::vector< Point* > &edges = grid.cell( c, r );
+
+				for( unsigned i = 0; i < edges.size( ); i++ )
+				{
+					Point* p = edges[ i ];
+
+					if( ( hx >= p->x ) && ( p->x >= mx ) && ( hx != p->x ) &&
+						pointInTriangle( hy < my ? hx : qx, hy, mx, my, hy < my ? qx : hx, hy, p->x, p->y ) )
+					{
+						double tan = std::fabs( hy - p->y ) / ( hx - p->x );
+
+						if( locallyInside( p, hole ) &&
+							( ( tan < tanMin ) || ( ( tan == tanMin ) && ( ( p->x > bridge->x ) || ( ( p->x == bridge->x ) && sectorContainsSector( bridge, p ) ) ) ) ) )
+						{
+							bridge = p;
+							tanMin = tan;
+						}
+					}
+				}
+			}
+		}
+
+		return bridge;
+	}
+
+	/**
+	 * \brief Sorts holes by the x-value of their leftmost Point.
+	 */
+	bool holeCompare( const std::pair< Point*, Polygon* > &i, const std::pair< Point*, Polygon* > &j )
+	{
+		return i.first->x < j.first->x;
+	}
+
+	/**
+	 * \brief Merges the children into the polygon using ray cast bridges.
+	 *
+	 * Holes are merged from left to right, so a hole may bridge to one merged before it.
+	 * Both searches only visit the grid cells around the hole, and nothing is copied
+	 * besides the spliced Points.
+	 */
+	void mergeRayCast( Polygon &poly )
+	{
+		std::vector< std::pair< Point*, Polygon* > > holes;		// leftmost point, hole
+
+		for( unsigned i = 0; i < poly.numChildren( ); i++ )
+		{
+			Polygon* child = poly.getChild( i );
+			Point* active = child->get( );
+
+			if( child->numPoints( ) < 3 )
+				continue;
+
+			Point* leftmost = active;
+
+			do
+			{
+				if( ( active->x < leftmost->x ) || ( ( active->x == leftmost->x ) && ( active->y < leftmost->y ) ) )
+					leftmost = active;
+
+				active = active->next;
+			} while( active != child->get( ) );
+
+			holes.push_back( std::pair< Point*, Polygon* >( leftmost, child ) );
+		}
+
+		if( holes.empty( ) || ( poly.numPoints( ) < 3 ) )
+			return;
+
+		std::sort( holes.begin( ), holes.end( ), holeCompare );
+
+		//--------------------------------------------
+
+		EdgeGrid grid;
+		initGrid( grid, poly );
+		insertEdges( grid, poly );
+
+		for( unsigned i = 0; i < holes.size( ); i++ )
+		{
+			Point* bridge = findBridge( grid, holes[ i ].first );
+
+			if( bridge == NULL )
+				continue;	// not inside the polygon
+
+			spliceHole( poly, *holes[ i ].second, grid, bridge, holes[ i ].first );
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+	// Parallel bridge search
+
+	/**
+	 * \brief State shared by the threads searching for bridges.
+	 *
+	 * While the search runs nothing is spliced, so the polygons and grid are only read.
+	 */
+	struct MergeJob
+	{
+		Polygon* outer;
+		EdgeGrid* grid;
+
+		const std::vector< Polygon* >* children;
+		const std::vector< std::pair< int, Scalar > >* order;
+
+		std::atomic< unsigned > nextChild;		// next unclaimed position in order
+
+		std::vector< bool > turned;			// one per position in order; the child is reversed when spliced
+
+		std::vector< std::pair< Point*, Point* > > splits;		// one per position in order
+		std::vector< int > targets;								// position in order of the child each split leads to, -1 for outer
+	};
+
+	/**
+	 * \brief Appends the Points of the Polygon to the candidates, marked with where they come from.
+	 */
+	void addCandidates( std::vector< std::pair< Point*, int > > &candidates, Polygon &poly, int source )
+	{
+		Point* active = poly.get( );
+
+		for( unsigned i = 0; i < poly.numPoints( ); i++ )
+		{
+			candidates.push_back( std::pair< Point*, int >( active, source ) );
+			active = active->next;
+		}
+	}
+
+	/**
+	 * \brief Claims children until none are left, finding the bridge of each as if all children before it were merged.
+	 *
+	 * A child may bridge to the outer polygon or to any child ahead of it in the order that
+	 * will be spliced rather than copied, as those Points keep their place once merged.
+	 */
+	void runMergeWorker( MergeJob* job )
+	{
+		std::vector< std::pair< Point*, int > > candidates;
+
+		for( unsigned i = job->nextChild++; i < job->order->size( ); i = job->nextChild++ )
+		{
+			Polygon* inner = ( *job->children )[ ( *job->order )[ i ].first ];
+			Point* smallest = findSmallest( *inner, ( *job->order )[ i ].second );
+
+			candidates.clear( );
+			addCandidates( candidates, *job->outer, -1 );
+
+			for( unsigned j = 0; j < i; j++ )
+			{
+				Polygon* ahead = ( *job->children )[ ( *job->order )[ j ].first ];
+
+				if( ahead->getPool( ) == job->outer->getPool( ) )
+					addCandidates( candidates, *ahead, j );
+			}
+
+			std::sort( candidates.begin( ), candidates.end( ), PointCompare( *smallest ) );
+
+			job->splits[ i ] = std::pair< Point*, Point* >( smallest, NULL );
+
+			for( unsigned j = 0; j < candidates.size( ); j++ )
+			{
+				Point* b = candidates[ j ].first;
+				int source = candidates[ j ].second;
+
+				// Test the corner at b as it will be once its child is spliced
+				bool turned = ( source >= 0 ) && job->turned[ source ];
+
+				if( inCorner( turned ? b->next : b->previous, b, turned ? b->previous : b->next, smallest ) &&
+					!job->grid->crosses( smallest, b ) )
+				{
+					job->splits[ i ].second = candidates[ j ].first;
+					job->targets[ i ] = candidates[ j ].second;
+					break;
+				}
+			}
+		}
+	}
+
+	/**
+	 * \brief Finds a bridge for every child at once, before any of them is merged.
+	 */
+	void findSplits( MergeJob &job, unsigned numThreads )
+	{
+		job.nextChild = 0;
+		job.splits.resize( job.order->size( ) );
+		job.targets.resize( job.order->size( ), -1 );
+		job.turned.resize( job.order->size( ) );
+
+		for( unsigned i = 0; i < job.order->size( ); i++ )
+			job.turned[ i ] = isCounterClockwise( *( *job.children )[ ( *job.order )[ i ].first ]->get( ) );
+
+		std::vector< std::thread > threads;
+
+		// The calling thread acts as the first worker
+		for( unsigned i = 1; i < numThreads; i++ )
+			threads.push_back( std::thread( runMergeWorker, &job ) );
+
+		runMergeWorker( &job );
+
+		for( unsigned i = 0; i < threads.size( ); i++ )
+			threads[ i ].join( );
+	}
+
 	//--------------------------------------------------------------------------------------
 
 	/**
 	 * \author ssell
 	 * \brief Merges a Polygon with its children to create one unified Polygon that may be triangulated.
 	 */
-    void mergePolygon( Polygon &poly )
+    void mergePolygon( Polygon &poly, BridgeMode mode, unsigned numThreads )
     {
+		if( poly.get( ) == NULL )
+			return;
+
+		if( mode == BRIDGE_RAY_CAST )
+		{
+			mergeRayCast( poly );
+			return;
+		}
+
         std::vector< Polygon* > children = poly.getChildren( );
-		std::vector< std::pair< int, int > > order = childOrder( children );
+		std::vector< std::pair< int, Scalar > > order = childOrder( children );
+
+		std::pair< Point*, Point* > connection;
 
-		std::pair< Point, Point > connection;
+		// Bridges are tested against the outer polygon and every child, merged or not
+		EdgeGrid grid;
+		initGrid( grid, poly );
+		insertEdges( grid, poly );
 
-		Point* temp;
+		for( unsigned i = 0; i < children.size( ); i++ )
+			insertEdges( grid, *children[ i ] );
 
 		//--------------------------------------------
 
+		if( numThreads == 0 )
+			numThreads = std::max( std::thread::hardware_concurrency( ), 1u );
+
+		numThreads = std::min( numThreads, static_cast< unsigned >( order.size( ) ) );
+
+		/*
+			With enough children, the bridges of all of them are searched
+			for up front and in parallel. Those are then spliced one at a
+			time as before, checking that each is still visible past the
+			children spliced ahead of it. Only if it is not, is a fresh
+			search made against the merged polygon.
+		*/
+		MergeJob job;
+		job.outer = &poly;
+		job.grid = &grid;
+		job.children = &children;
+		job.order = &order;
+
+		bool presearched = ( numThreads > 1 ) && ( order.size( ) >= MERGE_PARALLEL_CHILDREN );
+
+		std::vector< bool > merged( order.size( ), false );
+		std::vector< Point* > ordered;
+
+		if( presearched )
+			findSplits( job, numThreads );
+
 		for( int i = 0; i < order.size( ); i++ )
 		{
-			connection = getSplit( poly, *children.at( order[ i ].first ), order[ i ].second );
+			bool valid = false;
+
+			if( presearched )
+			{
+				connection = job.splits[ i ];
+				valid = ( connection.second != NULL ) && ( ( job.targets[ i ] < 0 ) || merged[ job.targets[ i ] ] ) &&
+				        isVisible( grid, connection.first, connection.second );
+			}
+
+			if( !valid )
+				connection = getSplit( poly, *children.at( order[ i ].first ), order[ i ].second, grid, ordered );
+
+			if( connection.second == NULL )
+				continue;	// no visible point; the child is not inside the polygon
 
 			/*
-			 Insert the points of the child into the parent polygon.
-			 We will insert prior to the parent point (connection.second), and insert in the order
-			 of smallest->next (connection.first.next), and iterate through the points until
-			 we insert the smallest. To finish, the closest will be inserted once more.
+			 Move the points of the child into the parent polygon.
+			 They are spliced in after the parent point (connection.second), beginning with the
+			 smallest (connection.first) and running clockwise. To finish, the smallest and
+			 the closest will each be inserted once more.
 
 			 Parent: A, B, C, D, E, F
 			 Child: 1, 2, 3
@@ -382,17 +1025,8 @@ namespace EarClipping
 							  F-------------------------------A
 			*/
 
-			poly.insertPoint( connection.first.x, connection.first.y, &connection.second );
-			temp = &connection.first;
-
-			do
-			{
-				temp = temp->next;
-				poly.insertPoint( temp->x, temp->y, temp->previous );
-			} while( temp->x != connection.first.x || temp->y != connection.first.y );
-
-			poly.insertPoint( connection.second.x, connection.second.y, temp );	// insert stops at the first occurence of a particular
-																					    // point and so no need to fear the wrong one being used.
+			spliceHole( poly, *children.at( order[ i ].first ), grid, connection.second, connection.first );
+			merged[ i ] = true;
 		}
     }
 }
\ No newline at end of file
@@ -0,0 +1,254 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2018 Steven T Sell (ssell@vertexfragment.com)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "earClipping_Core.h"
+
+#include <cstring>
+#include <fstream>
+
+#if defined( _WIN32 )
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//------------------------------------------------------------------------------------------
+
+namespace EarClipping
+{
+	const char MESH_FILE_MAGIC[ 4 ] = { 'E', 'C', 'M', 'S' };
+
+#if defined( EAR_CLIPPING_DOUBLE )
+	const uint32_t MESH_FILE_SCALAR = MESH_SCALAR_DOUBLE;
+#elif defined( EAR_CLIPPING_INT32 )
+	const uint32_t MESH_FILE_SCALAR = MESH_SCALAR_INT32;
+#else
+	const uint32_t MESH_FILE_SCALAR = MESH_SCALAR_FLOAT;
+#endif
+
+	/**
+	 * \brief Rounds offset up to the next multiple of MESH_FILE_ALIGNMENT.
+	 */
+	uint64_t alignMeshOffset( uint64_t offset )
+	{
+		return ( offset + MESH_FILE_ALIGNMENT - 1 ) & ~static_cast< uint64_t >( MESH_FILE_ALIGNMENT - 1 );
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	bool writeMesh( const char* path, const std::vector< Scalar > &vertices, const std::vector< uint32_t > &indices )
+	{
+		std::ofstream file( path, std::ios::out | std::ios::binary | std::ios::trunc );
+
+		if( !file.is_open( ) )
+			return false;
+
+		MeshFileHeader header;
+
+		std::memcpy( header.magic, MESH_FILE_MAGIC, sizeof( header.magic ) );
+		header.version = MESH_FILE_VERSION;
+		header.scalarType = MESH_FILE_SCALAR;
+		header.scalarSize = sizeof( Scalar );
+		header.numVertices = static_cast< uint32_t >( vertices.size( ) / 2 );
+		header.numIndices = static_cast< uint32_t >( indices.size( ) );
+		header.vertexOffset = alignMeshOffset( sizeof( MeshFileHeader ) );
+		header.indexOffset = alignMeshOffset( header.vertexOffset + static_cast< uint64_t >( header.numVertices ) * 2 * sizeof( Scalar ) );
+
+		const char padding[ MESH_FILE_ALIGNMENT ] = { 0 };
+
+		file.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+		file.write( padding, header.vertexOffset - sizeof( header ) );
+
+		if( !vertices.empty( ) )
+			file.write( reinterpret_cast< const char* >( &vertices[ 0 ] ), static_cast< uint64_t >( header.numVertices ) * 2 * sizeof( Scalar ) );
+
+		file.write( padding, header.indexOffset - ( header.vertexOffset + static_cast< uint64_t >( header.numVertices ) * 2 * sizeof( Scalar ) ) );
+
+		if( !indices.empty( ) )
+			file.write( reinterpret_cast< const char* >( &indices[ 0 ] ), indices.size( ) * sizeof( uint32_t ) );
+
+		return file.good( );
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	MappedFile::MappedFile( )
+		: m_Data( NULL ), m_Size( 0 )
+	{
+
+	}
+
+	MappedFile::~MappedFile( )
+	{
+		close( );
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	bool MappedFile::open( const char* path )
+	{
+		close( );
+
+#if defined( _WIN32 )
+		HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+		if( file == INVALID_HANDLE_VALUE )
+			return false;
+
+		LARGE_INTEGER size;
+
+		if( !GetFileSizeEx( file, &size ) || size.QuadPart == 0 )
+		{
+			CloseHandle( file );
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+		CloseHandle( file );
+
+		if( mapping == NULL )
+			return false;
+
+		// The view keeps the mapping alive once it is made
+		void* data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		CloseHandle( mapping );
+
+		if( data == NULL )
+			return false;
+
+		m_Data = static_cast< const char* >( data );
+		m_Size = static_cast< size_t >( size.QuadPart );
+#else
+		int file = ::open( path, O_RDONLY );
+
+		if( file < 0 )
+			return false;
+
+		struct stat info;
+
+		if( fstat( file, &info ) != 0 || info.st_size == 0 )
+		{
+			::close( file );
+			return false;
+		}
+
+		// The mapping stays valid after the descriptor is closed
+		void* data = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+		::close( file );
+
+		if( data == MAP_FAILED )
+			return false;
+
+		m_Data = static_cast< const char* >( data );
+		m_Size = static_cast< size_t >( info.st_size );
+#endif
+
+		return true;
+	}
+
+	void MappedFile::close( )
+	{
+		if( m_Data == NULL )
+			return;
+
+#if defined( _WIN32 )
+		UnmapViewOfFile( m_Data );
+#else
+		munmap( const_cast< char* >( m_Data ), m_Size );
+#endif
+
+		m_Data = NULL;
+		m_Size = 0;
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	bool MeshFile::open( const char* path )
+	{
+		if( !m_File.open( path ) )
+			return false;
+
+		size_t size = m_File.size( );
+
+		if( size < sizeof( MeshFileHeader ) )
+		{
+			close( );
+			return false;
+		}
+
+		//--------------------------------------------
+		// Only the header is checked; the blocks are used in place
+
+		const MeshFileHeader* h = header( );
+
+		bool valid = std::memcmp( h->magic, MESH_FILE_MAGIC, sizeof( h->magic ) ) == 0 &&
+		             h->version == MESH_FILE_VERSION &&
+		             h->scalarType == MESH_FILE_SCALAR &&
+		             h->scalarSize == sizeof( Scalar ) &&
+		             h->vertexOffset % MESH_FILE_ALIGNMENT == 0 &&
+		             h->indexOffset % MESH_FILE_ALIGNMENT == 0 &&
+		             h->vertexOffset >= sizeof( MeshFileHeader ) &&
+		             h->vertexOffset <= size &&
+		             h->numVertices <= ( size - h->vertexOffset ) / ( 2 * sizeof( Scalar ) ) &&
+		             h->indexOffset <= size &&
+		             h->numIndices <= ( size - h->indexOffset ) / sizeof( uint32_t );
+
+		if( !valid )
+		{
+			close( );
+			return false;
+		}
+
+		return true;
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	uint32_t MeshFile::numVertices( ) const
+	{
+		return isOpen( ) ? header( )->numVertices : 0;
+	}
+
+	uint32_t MeshFile::numIndices( ) const
+	{
+		return isOpen( ) ? header( )->numIndices : 0;
+	}
+
+	const Scalar* MeshFile::vertices( ) const
+	{
+		return isOpen( ) ? reinterpret_cast< const Scalar* >( m_File.data( ) + header( )->vertexOffset ) : NULL;
+	}
+
+	const uint32_t* MeshFile::indices( ) const
+	{
+		return isOpen( ) ? reinterpret_cast< const uint32_t* >( m_File.data( ) + header( )->indexOffset ) : NULL;
+	}
+};
@@ -0,0 +1,691 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2018 Steven T Sell (ssell@vertexfragment.com)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "earClipping_Core.h"
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+//------------------------------------------------------------------------------------------
+
+namespace EarClipping
+{
+	/**
+	 * \brief Working state of the monotone decomposition.
+	 *
+	 * Each diagonal splits the ring it is added to in two. Both ends of the diagonal are
+	 * duplicated for this, so every piece remains a plain ring that can be walked by index.
+	 * The duplicates keep the outgoing edge of the point they copy and source maps them
+	 * back onto the input vertex.
+	 */
+	struct MonotoneRing
+	{
+		const Scalar* vertices;
+
+		std::vector< uint32_t > source;
+		std::vector< uint32_t > next;
+		std::vector< uint32_t > previous;
+
+		const Scalar* point( uint32_t index ) const { return vertices + ( source[ index ] * 2 ); }
+
+		uint32_t duplicate( uint32_t index )
+		{
+			source.push_back( source[ index ] );
+			next.push_back( next[ index ] );
+			previous.push_back( previous[ index ] );
+
+			return source.size( ) - 1;
+		}
+	};
+
+	/**
+	 * \brief Edge of the sweep status, running from its start point to the next point of the ring.
+	 *
+	 * The end points are copied in so the ordering does not depend on any shared state.
+	 * index is the ring point the edge starts at; it is updated when that point is duplicated.
+	 */
+	struct SweepEdge
+	{
+		Scalar x1, y1;
+		Scalar x2, y2;
+
+		mutable uint32_t index;
+
+		bool operator<( const SweepEdge &other ) const;
+	};
+
+	typedef std::multiset< SweepEdge > SweepStatus;
+
+	enum MonotoneVertexType
+	{
+		VERTEX_REGULAR,
+		VERTEX_START,
+		VERTEX_END,
+		VERTEX_SPLIT,
+		VERTEX_MERGE
+	};
+
+	//------------------------------------------------------------------------------------------
+
+	/// Returns the sign of the turn a -> b -> c: positive if counter-clockwise, negative if clockwise
+	int turn( Scalar ax, Scalar ay, Scalar bx, Scalar by, Scalar cx, Scalar cy )
+	{
+		WideScalar area = ( static_cast< WideScalar >( bx - ax ) * ( cy - ay ) ) - ( static_cast< WideScalar >( by - ay ) * ( cx - ax ) );
+
+		return ( area > 0 ) - ( area < 0 );
+	}
+
+	bool isLeftTurn( Scalar ax, Scalar ay, Scalar bx, Scalar by, Scalar cx, Scalar cy )
+	{
+		return turn( ax, ay, bx, by, cx, cy ) > 0;
+	}
+
+	bool isLeftTurn( const Scalar* a, const Scalar* b, const Scalar* c )
+	{
+		return isLeftTurn( a[ 0 ], a[ 1 ], b[ 0 ], b[ 1 ], c[ 0 ], c[ 1 ] );
+	}
+
+	/**
+	 * \brief Sweep order. The sweep runs from the greatest y down; points sharing a y are
+	 * taken from the greatest x down, and coincident points by input index.
+	 */
+	bool isBelow( const MonotoneRing &ring, uint32_t a, uint32_t b )
+	{
+		const Scalar* pa = ring.point( a );
+		const Scalar* pb = ring.point( b );
+
+		if( pa[ 1 ] != pb[ 1 ] )
+			return pa[ 1 ] < pb[ 1 ];
+
+		if( pa[ 0 ] != pb[ 0 ] )
+			return pa[ 0 ] < pb[ 0 ];
+
+		return ring.source[ a ] > ring.source[ b ];
+	}
+
+	/**
+	 * Edges in the status never cross, so the one that starts lower is compared against
+	 * the line through the other. For an edge running down, a counter-clockwise turn
+	 * towards a point means the point lies to its right. Edges leaving the same point
+	 * (as at the bridges of a merged polygon) are told apart by their other end.
+	 */
+	bool SweepEdge::operator<( const SweepEdge &other ) const
+	{
+		int side;
+
+		if( ( other.y1 == other.y2 ) && ( y1 == y2 ) )
+			return y1 < other.y1;
+
+		if( ( other.y1 != other.y2 ) && ( ( y1 == y2 ) || ( y1 < other.y1 ) ) )
+		{
+			// Which side of other this lies on
+			side = turn( other.x1, other.y1, other.x2, other.y2, x1, y1 );
+
+			if( side == 0 )
+				side = turn( other.x1, other.y1, other.x2, other.y2, x2, y2 );
+
+			return side < 0;
+		}
+
+		// Which side of this other lies on
+		side = turn( x1, y1, x2, y2, other.x1, other.y1 );
+
+		if( side == 0 )
+			side = turn( x1, y1, x2, y2, other.x2, other.y2 );
+
+		return side > 0;
+	}
+
+	/**
+	 * \brief Sorts points into the order the sweep visits them.
+	 */
+	struct SweepOrder
+	{
+		SweepOrder( const MonotoneRing &sweepRing )
+			: ring( &sweepRing ) { }
+
+		bool operator()( uint32_t a, uint32_t b ) const { return isBelow( *ring, b, a ); }
+
+		const MonotoneRing* ring;
+	};
+
+	//------------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Shared state of the sweep. Indexed by ring point; entries for the start point of an edge describe that edge.
+	 */
+	struct MonotoneSweep
+	{
+		MonotoneRing ring;
+
+		std::vector< unsigned char > type;
+		std::vector< uint32_t > helper;
+		std::vector< SweepStatus::iterator > edge;
+
+		SweepStatus status;
+
+		SweepEdge edgeFrom( uint32_t index ) const
+		{
+			SweepEdge result;
+
+			result.x1 = ring.point( index )[ 0 ];
+			result.y1 = ring.point( index )[ 1 ];
+			result.x2 = ring.point( ring.next[ index ] )[ 0 ];
+			result.y2 = ring.point( ring.next[ index ] )[ 1 ];
+			result.index = index;
+
+			return result;
+		}
+
+		void insertEdge( uint32_t index, uint32_t helperIndex )
+		{
+			edge[ index ] = status.insert( edgeFrom( index ) );
+			helper[ index ] = helperIndex;
+		}
+
+		/// Returns false if the edge was never entered, which only happens on self-intersecting input
+		bool eraseEdge( uint32_t index )
+		{
+			if( edge[ index ] == status.end( ) )
+				return false;
+
+			status.erase( edge[ index ] );
+			edge[ index ] = status.end( );
+
+			return true;
+		}
+
+		/// Returns the edge directly left of the point, or the end of the status if there is none
+		SweepStatus::iterator edgeLeftOf( uint32_t index )
+		{
+			SweepEdge key;
+
+			key.x1 = key.x2 = ring.point( index )[ 0 ];
+			key.y1 = key.y2 = ring.point( index )[ 1 ];
+
+			SweepStatus::iterator found = status.lower_bound( key );
+
+			if( found == status.begin( ) )
+				return status.end( );
+
+			return --found;
+		}
+
+		/**
+		 * \brief Splits the ring along the diagonal a-b. Returns the duplicate of a, which
+		 * carries on with the outgoing edge of a.
+		 *
+		 * As the duplicate stays with the outgoing edge, it is the point to use for any later
+		 * diagonal into the region that edge bounds.
+		 */
+		uint32_t addDiagonal( uint32_t a, uint32_t b )
+		{
+			uint32_t copyA = ring.duplicate( a );
+			uint32_t copyB = ring.duplicate( b );
+
+			ring.previous[ ring.next[ a ] ] = copyA;
+			ring.previous[ ring.next[ b ] ] = copyB;
+
+			ring.next[ a ] = copyB;
+			ring.previous[ copyB ] = a;
+			ring.next[ b ] = copyA;
+			ring.previous[ copyA ] = b;
+
+			// The duplicates take over the edges that start at a and b
+			uint32_t copies[ 2 ] = { copyA, copyB };
+			uint32_t originals[ 2 ] = { a, b };
+
+			for( unsigned i = 0; i < 2; i++ )
+			{
+				type.push_back( type[ originals[ i ] ] );
+				helper.push_back( helper[ originals[ i ] ] );
+				edge.push_back( edge[ originals[ i ] ] );
+
+				edge[ originals[ i ] ] = status.end( );
+
+				if( edge[ copies[ i ] ] != status.end( ) )
+					edge[ copies[ i ] ]->index = copies[ i ];
+			}
+
+			return copyA;
+		}
+	};
+
+	//------------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Adds the diagonals that cut the ring into y-monotone pieces. Returns false if the sweep failed (self-intersecting input).
+	 * source: de Berg et al., Computational Geometry: Algorithms and Applications, ch. 3
+	 */
+	bool splitMonotone( MonotoneSweep &sweep, std::vector< uint32_t > &order )
+	{
+		MonotoneRing &ring = sweep.ring;
+
+		uint32_t numPoints = ring.source.size( );
+
+		sweep.type.resize( numPoints );
+		sweep.helper.resize( numPoints );
+		sweep.edge.resize( numPoints, sweep.status.end( ) );
+
+		for( uint32_t i = 0; i < numPoints; i++ )
+		{
+			uint32_t previous = ring.previous[ i ];
+			uint32_t next = ring.next[ i ];
+
+			bool convex = isLeftTurn( ring.point( previous ), ring.point( i ), ring.point( next ) );
+
+			if( isBelow( ring, previous, i ) && isBelow( ring, next, i ) )
+				sweep.type[ i ] = convex ? VERTEX_START : VERTEX_SPLIT;
+			else if( isBelow( ring, i, previous ) && isBelow( ring, i, next ) )
+				sweep.type[ i ] = convex ? VERTEX_END : VERTEX_MERGE;
+			else
+				sweep.type[ i ] = VERTEX_REGULAR;
+		}
+
+		//--------------------------------------------
+
+		for( uint32_t i = 0; i < numPoints; i++ )
+		{
+			uint32_t active = order[ i ];
+			uint32_t outgoing = active;		// point that currently owns the outgoing edge of active
+			uint32_t previous = ring.previous[ active ];
+
+			// Edges are looked up again after each diagonal, which may hand them to a duplicate
+			SweepStatus::iterator left;
+
+			switch( sweep.type[ active ] )
+			{
+			case VERTEX_START:
+				sweep.insertEdge( active, active );
+				break;
+
+			case VERTEX_END:
+				if( sweep.type[ sweep.helper[ previous ] ] == VERTEX_MERGE )
+					sweep.addDiagonal( active, sweep.helper[ previous ] );
+
+				if( !sweep.eraseEdge( ring.previous[ active ] ) )
+					return false;
+				break;
+
+			case VERTEX_SPLIT:
+				left = sweep.edgeLeftOf( active );
+
+				if( left == sweep.status.end( ) )
+					return false;
+
+				outgoing = sweep.addDiagonal( active, sweep.helper[ left->index ] );
+				sweep.helper[ left->index ] = active;
+
+				sweep.insertEdge( outgoing, outgoing );
+				break;
+
+			case VERTEX_MERGE:
+				if( sweep.type[ sweep.helper[ previous ] ] == VERTEX_MERGE )
+					outgoing = sweep.addDiagonal( active, sweep.helper[ previous ] );
+
+				if( !sweep.eraseEdge( ring.previous[ active ] ) )
+					return false;
+
+				left = sweep.edgeLeftOf( active );
+
+				if( left == sweep.status.end( ) )
+					return false;
+
+				if( sweep.type[ sweep.helper[ left->index ] ] == VERTEX_MERGE )
+					sweep.addDiagonal( outgoing, sweep.helper[ left->index ] );
+
+				sweep.helper[ left->index ] = outgoing;
+				break;
+
+			default:
+				// The interior lies to the right when the boundary runs downwards
+				if( isBelow( ring, active, previous ) )
+				{
+					if( sweep.type[ sweep.helper[ previous ] ] == VERTEX_MERGE )
+						outgoing = sweep.addDiagonal( active, sweep.helper[ previous ] );
+
+					if( !sweep.eraseEdge( ring.previous[ active ] ) )
+						return false;
+
+					sweep.insertEdge( outgoing, outgoing );
+				}
+				else
+				{
+					left = sweep.edgeLeftOf( active );
+
+					if( left == sweep.status.end( ) )
+						return false;
+
+					if( sweep.type[ sweep.helper[ left->index ] ] == VERTEX_MERGE )
+						sweep.addDiagonal( active, sweep.helper[ left->index ] );
+
+					sweep.helper[ left->index ] = active;
+				}
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	//------------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Triangulates a single y-monotone piece in linear time, writing the triangles counter-clockwise.
+	 */
+	void triangulatePiece( const MonotoneRing &ring, const std::vector< uint32_t > &piece, std::vector< uint32_t > &stack,
+		                   std::vector< uint32_t > &sorted, std::vector< char > &side, std::vector< uint32_t > &indices )
+	{
+		uint32_t numPoints = piece.size( );
+
+		if( numPoints == 3 )
+		{
+			for( unsigned i = 0; i < 3; i++ )
+				indices.push_back( ring.source[ piece[ i ] ] );
+
+			return;
+		}
+
+		uint32_t top = 0;
+		uint32_t bottom = 0;
+
+		for( uint32_t i = 1; i < numPoints; i++ )
+		{
+			if( isBelow( ring, piece[ top ], piece[ i ] ) )
+				top = i;
+
+			if( isBelow( ring, piece[ i ], piece[ bottom ] ) )
+				bottom = i;
+		}
+
+		//--------------------------------------------
+		// Merge the two chains from the top down. Counter-clockwise from the top runs down the left chain.
+
+		sorted.resize( numPoints );
+		side.assign( numPoints, 0 );		// index into piece: 1 = left chain, -1 = right chain
+
+		uint32_t left = ( top + 1 ) % numPoints;
+		uint32_t right = ( top + numPoints - 1 ) % numPoints;
+
+		sorted[ 0 ] = top;
+
+		for( uint32_t i = 1; i < numPoints - 1; i++ )
+		{
+			if( isBelow( ring, piece[ left ], piece[ right ] ) )
+			{
+				sorted[ i ] = right;
+				side[ right ] = -1;
+				right = ( right + numPoints - 1 ) % numPoints;
+			}
+			else
+			{
+				sorted[ i ] = left;
+				side[ left ] = 1;
+				left = ( left + 1 ) % numPoints;
+			}
+		}
+
+		sorted[ numPoints - 1 ] = bottom;
+
+		//--------------------------------------------
+
+		stack.clear( );
+		stack.push_back( sorted[ 0 ] );
+		stack.push_back( sorted[ 1 ] );
+
+		for( uint32_t i = 2; i < numPoints - 1; i++ )
+		{
+			uint32_t active = sorted[ i ];
+
+			if( side[ active ] != side[ stack.back( ) ] )
+			{
+				// Opposite chain; everything on the stack is visible
+				for( uint32_t j = 0; j + 1 < stack.size( ); j++ )
+				{
+					if( side[ active ] == 1 )
+					{
+						indices.push_back( ring.source[ piece[ stack[ j + 1 ] ] ] );
+						indices.push_back( ring.source[ piece[ stack[ j ] ] ] );
+					}
+					else
+					{
+						indices.push_back( ring.source[ piece[ stack[ j ] ] ] );
+						indices.push_back( ring.source[ piece[ stack[ j + 1 ] ] ] );
+					}
+
+					indices.push_back( ring.source[ piece[ active ] ] );
+				}
+
+				stack.clear( );
+				stack.push_back( sorted[ i - 1 ] );
+				stack.push_back( active );
+			}
+			else
+			{
+				// Same chain; clip while the diagonal to the stack stays inside
+				uint32_t last = stack.back( );
+				stack.pop_back( );
+
+				while( !stack.empty( ) )
+				{
+					const Scalar* a = ring.point( piece[ active ] );
+					const Scalar* b = ring.point( piece[ stack.back( ) ] );
+					const Scalar* c = ring.point( piece[ last ] );
+
+					if( side[ active ] == 1 ? !isLeftTurn( a, b, c ) : !isLeftTurn( a, c, b ) )
+						break;
+
+					indices.push_back( ring.source[ piece[ active ] ] );
+
+					if( side[ active ] == 1 )
+					{
+						indices.push_back( ring.source[ piece[ stack.back( ) ] ] );
+						indices.push_back( ring.source[ piece[ last ] ] );
+					}
+					else
+					{
+						indices.push_back( ring.source[ piece[ last ] ] );
+						indices.push_back( ring.source[ piece[ stack.back( ) ] ] );
+					}
+
+					last = stack.back( );
+					stack.pop_back( );
+				}
+
+				stack.push_back( last );
+				stack.push_back( active );
+			}
+		}
+
+		uint32_t active = sorted[ numPoints - 1 ];
+
+		for( uint32_t j = 0; j + 1 < stack.size( ); j++ )
+		{
+			if( side[ stack[ j + 1 ] ] == 1 )
+			{
+				indices.push_back( ring.source[ piece[ stack[ j ] ] ] );
+				indices.push_back( ring.source[ piece[ stack[ j + 1 ] ] ] );
+			}
+			else
+			{
+				indices.push_back( ring.source[ piece[ stack[ j + 1 ] ] ] );
+				indices.push_back( ring.source[ piece[ stack[ j ] ] ] );
+			}
+
+			indices.push_back( ring.source[ piece[ active ] ] );
+		}
+	}
+
+	//------------------------------------------------------------------------------------------
+	//------------------------------------------------------------------------------------------
+	//------------------------------------------------------------------------------------------
+
+	unsigned triangulateMonotone( const std::vector< Scalar > &vertices, const std::vector< uint32_t > &ringStarts, std::vector< uint32_t > &indices )
+	{
+		indices.clear( );
+
+		uint32_t numPoints = vertices.size( ) / 2;
+
+		if( ( numPoints < 3 ) || ringStarts.empty( ) )
+			return 0;
+
+		MonotoneSweep sweep;
+		MonotoneRing &ring = sweep.ring;
+
+		ring.vertices = &vertices[ 0 ];
+
+		// Each diagonal adds two points, and there are fewer diagonals than points
+		ring.source.reserve( numPoints * 3 );
+		ring.next.reserve( numPoints * 3 );
+		ring.previous.reserve( numPoints * 3 );
+
+		ring.source.resize( numPoints );
+		ring.next.resize( numPoints );
+		ring.previous.resize( numPoints );
+
+		//--------------------------------------------
+		// Link the rings so the outer boundary runs counter-clockwise and the holes clockwise
+
+		double coveredArea = 0;		// twice the area the triangles must cover
+
+		for( uint32_t r = 0; r < ringStarts.size( ); r++ )
+		{
+			uint32_t first = ringStarts[ r ];
+			uint32_t last = ( r + 1 < ringStarts.size( ) ) ? ringStarts[ r + 1 ] : numPoints;
+
+			if( last - first < 3 )
+				return 0;
+
+			double area = 0;
+
+			for( uint32_t i = first; i < last; i++ )
+			{
+				uint32_t j = ( i + 1 < last ) ? ( i + 1 ) : first;
+				area += ( static_cast< double >( vertices[ i * 2 ] ) * vertices[ ( j * 2 ) + 1 ] ) - ( static_cast< double >( vertices[ j * 2 ] ) * vertices[ ( i * 2 ) + 1 ] );
+			}
+
+			bool forward = ( r == 0 ) ? ( area > 0 ) : ( area < 0 );
+
+			coveredArea += ( r == 0 ) ? std::fabs( area ) : -std::fabs( area );
+
+			for( uint32_t i = first; i < last; i++ )
+			{
+				uint32_t after = ( i + 1 < last ) ? ( i + 1 ) : first;
+				uint32_t before = ( i > first ) ? ( i - 1 ) : ( last - 1 );
+
+				ring.source[ i ] = i;
+				ring.next[ i ] = forward ? after : before;
+				ring.previous[ i ] = forward ? before : after;
+			}
+		}
+
+		//--------------------------------------------
+
+		std::vector< uint32_t > order( numPoints );
+
+		for( uint32_t i = 0; i < numPoints; i++ )
+			order[ i ] = i;
+
+		std::sort( order.begin( ), order.end( ), SweepOrder( ring ) );
+
+		if( !splitMonotone( sweep, order ) )
+			return 0;
+
+		//--------------------------------------------
+		// Walk and triangulate each of the pieces
+
+		indices.reserve( ( numPoints + ( 2 * ringStarts.size( ) ) ) * 3 );
+
+		std::vector< char > visited( ring.source.size( ), false );
+		std::vector< uint32_t > piece;
+		std::vector< uint32_t > stack;
+		std::vector< uint32_t > sorted;
+		std::vector< char > side;
+
+		for( uint32_t i = 0; i < ring.source.size( ); i++ )
+		{
+			if( visited[ i ] )
+				continue;
+
+			piece.clear( );
+
+			uint32_t active = i;
+
+			do
+			{
+				visited[ active ] = true;
+				piece.push_back( active );
+				active = ring.next[ active ];
+			} while( active != i );
+
+			triangulatePiece( ring, piece, stack, sorted, side, indices );
+		}
+
+		// Anything else means the pieces overlapped, which degenerate input can cause
+		if( indices.size( ) != ( numPoints + ( 2 * ( ringStarts.size( ) - 1 ) ) - 2 ) * 3 )
+		{
+			indices.clear( );
+			return 0;
+		}
+
+		/*
+			The sweep assumes simple input. If the rings cross, the count
+			can still come out right with triangles that are flipped or that
+			overlap, so each one must turn counter-clockwise and together
+			they must cover exactly the area of the polygon.
+		*/
+
+		double triangleArea = 0;
+
+		for( uint32_t i = 0; i < indices.size( ); i += 3 )
+		{
+			const Scalar* a = &vertices[ indices[ i ] * 2 ];
+			const Scalar* b = &vertices[ indices[ i + 1 ] * 2 ];
+			const Scalar* c = &vertices[ indices[ i + 2 ] * 2 ];
+
+			if( turn( a[ 0 ], a[ 1 ], b[ 0 ], b[ 1 ], c[ 0 ], c[ 1 ] ) < 0 )
+			{
+				indices.clear( );
+				return 0;
+			}
+
+			double abx = static_cast< double >( b[ 0 ] ) - a[ 0 ];
+			double aby = static_cast< double >( b[ 1 ] ) - a[ 1 ];
+			double acx = static_cast< double >( c[ 0 ] ) - a[ 0 ];
+			double acy = static_cast< double >( c[ 1 ] ) - a[ 1 ];
+
+			triangleArea += ( abx * acy ) - ( aby * acx );
+		}
+
+		if( std::fabs( triangleArea - coveredArea ) > ( 1e-6 * std::fabs( coveredArea ) ) )
+		{
+			indices.clear( );
+			return 0;
+		}
+
+		return indices.size( ) / 3;
+	}
+}
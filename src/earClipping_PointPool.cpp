@@ -0,0 +1,119 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2018 Steven T Sell (ssell@vertexfragment.com)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "earClipping_Structures.h"
+
+#include <new>
+
+//------------------------------------------------------------------------------------------
+
+namespace EarClipping
+{
+	PointPool::PointPool( unsigned pointsPerBlock )
+	{
+		m_BlockSize = pointsPerBlock > 0 ? pointsPerBlock : 1;
+		m_CurrentBlock = 0;
+		m_BlockUsed = 0;
+		m_FreeList = NULL;
+		m_NumberAllocated = 0;
+	}
+
+	PointPool::~PointPool( )
+	{
+		for( unsigned i = 0; i < m_Blocks.size( ); i++ )
+			::operator delete( m_Blocks[ i ] );
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	Point* PointPool::allocate( Scalar x, Scalar y )
+	{
+		void* memory;
+
+		if( m_FreeList != NULL )
+		{
+			memory = m_FreeList;
+			m_FreeList = m_FreeList->next;
+		}
+		else
+		{
+			// Move on to the next block once the current one is used up
+			if( m_CurrentBlock < m_Blocks.size( ) && m_BlockUsed == m_BlockSize )
+			{
+				m_CurrentBlock++;
+				m_BlockUsed = 0;
+			}
+
+			if( m_CurrentBlock == m_Blocks.size( ) )
+				m_Blocks.push_back( static_cast< Point* >( ::operator new( sizeof( Point ) * m_BlockSize ) ) );
+
+			memory = m_Blocks[ m_CurrentBlock ] + m_BlockUsed;
+			m_BlockUsed++;
+		}
+
+		m_NumberAllocated++;
+
+		return new( memory ) Point( x, y );
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	void PointPool::reserve( unsigned count )
+	{
+		unsigned available = 0;
+
+		if( m_CurrentBlock < m_Blocks.size( ) )
+			available = ( m_BlockSize - m_BlockUsed ) + ( m_Blocks.size( ) - m_CurrentBlock - 1 ) * m_BlockSize;
+
+		while( available < count )
+		{
+			m_Blocks.push_back( static_cast< Point* >( ::operator new( sizeof( Point ) * m_BlockSize ) ) );
+			available += m_BlockSize;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	void PointPool::release( Point* point )
+	{
+		if( point == NULL )
+			return;
+
+		point->next = m_FreeList;
+		m_FreeList = point;
+
+		m_NumberAllocated--;
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	void PointPool::reset( )
+	{
+		m_CurrentBlock = 0;
+		m_BlockUsed = 0;
+		m_FreeList = NULL;
+		m_NumberAllocated = 0;
+	}
+};
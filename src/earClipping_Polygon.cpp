@@ -23,20 +23,27 @@
  */
 
 #include "earClipping_Structures.h"
+#include <algorithm>
 #include <iostream>
+#include <unordered_set>
 //------------------------------------------------------------------------------------------
 
 namespace EarClipping
 {
-    Polygon::Polygon( Polygon *p_Parent, float xA, float yA, float xB, float yB, float xC, float yC )
+	typedef std::unordered_set< std::pair< Scalar, Scalar >, CoordinateHash > CoordinateSet;
+
+	//--------------------------------------------------------------------------------------
+
+    Polygon::Polygon( Polygon *p_Parent, Scalar xA, Scalar yA, Scalar xB, Scalar yB, Scalar xC, Scalar yC )
     {
         parent = p_Parent;
+        m_Pool = parent != NULL ? parent->getPool( ) : NULL;
 
         // Add the points
 
-        Point* a = new Point( xA, yA );
-        Point* b = new Point( xB, yB );
-        Point* c = new Point( xC, yC );
+        Point* a = newPoint( xA, yA );
+        Point* b = newPoint( xB, yB );
+        Point* c = newPoint( xC, yC );
 
         head = a;
         head->next = b;
@@ -56,14 +63,15 @@ namespace EarClipping
         }
     }
 
-	 Polygon::Polygon( Polygon *p_Parent, float xA, float yA, float xB, float yB )
+	 Polygon::Polygon( Polygon *p_Parent, Scalar xA, Scalar yA, Scalar xB, Scalar yB )
     {
         parent = p_Parent;
+        m_Pool = parent != NULL ? parent->getPool( ) : NULL;
 
         // Add the points
 
-        Point* a = new Point( xA, yA );
-        Point* b = new Point( xB, yB );
+        Point* a = newPoint( xA, yA );
+        Point* b = newPoint( xB, yB );
 
         head = a;
         head->next = b;
@@ -80,13 +88,14 @@ namespace EarClipping
         }
     }
 
-	Polygon::Polygon( Polygon *p_Parent, float xA, float yA )
+	Polygon::Polygon( Polygon *p_Parent, Scalar xA, Scalar yA )
     {
         parent = p_Parent;
+        m_Pool = parent != NULL ? parent->getPool( ) : NULL;
 
         // Add the points
 
-        Point* a = new Point( xA, yA );
+        Point* a = newPoint( xA, yA );
 
         head = a;
         head->next = a;
@@ -103,6 +112,7 @@ namespace EarClipping
     Polygon::Polygon( Polygon *p_Parent )
     {
         parent = p_Parent;
+        m_Pool = parent != NULL ? parent->getPool( ) : NULL;
 
         head = NULL;
 
@@ -119,24 +129,160 @@ namespace EarClipping
 		parent = NULL;
 		head = NULL;
 		m_NumberOfPoints = 0;
+		m_Pool = NULL;
+	}
+
+	Polygon::Polygon( Polygon *p_Parent, PointPool *pool )
+	{
+		parent = p_Parent;
+		head = NULL;
+		m_NumberOfPoints = 0;
+		m_Pool = pool;
+
+		if( parent != NULL )
+        {
+            parent->addChild( this );
+        }
+	}
+
+	Polygon::Polygon( const Polygon &other )
+	{
+		parent = NULL;
+		head = NULL;
+		m_NumberOfPoints = 0;
+		m_Pool = other.m_Pool;
+
+		copyFrom( other );
+	}
+
+	Polygon::Polygon( Polygon &&other )
+	{
+		parent = NULL;
+		head = other.head;
+		children.swap( other.children );
+		m_OwnedChildren.swap( other.m_OwnedChildren );
+		m_NumberOfPoints = other.m_NumberOfPoints;
+		m_Pool = other.m_Pool;
+
+		for( unsigned i = 0; i < children.size( ); i++ )
+			children[ i ]->parent = this;
+
+		other.head = NULL;
+		other.m_NumberOfPoints = 0;
+	}
+
+	Polygon& Polygon::operator=( const Polygon &other )
+	{
+		if( this == &other )
+			return *this;
+
+		release( );
+
+		m_Pool = other.m_Pool;
+		copyFrom( other );
+
+		return *this;
+	}
+
+	Polygon& Polygon::operator=( Polygon &&other )
+	{
+		if( this == &other )
+			return *this;
+
+		release( );
+
+		head = other.head;
+		children.swap( other.children );
+		m_OwnedChildren.swap( other.m_OwnedChildren );
+		m_NumberOfPoints = other.m_NumberOfPoints;
+		m_Pool = other.m_Pool;
+
+		for( unsigned i = 0; i < children.size( ); i++ )
+			children[ i ]->parent = this;
+
+		other.head = NULL;
+		other.m_NumberOfPoints = 0;
+
+		return *this;
 	}
 
     //--------------------------------------------------------------------------------------
 
     Polygon::~Polygon( )
     {
-		Point* deleteMe;
+		release( );
+    }
+
+	//--------------------------------------------------------------------------------------
+
+	void Polygon::copyFrom( const Polygon &other )
+	{
+		if( m_Pool != NULL )
+			m_Pool->reserve( other.m_NumberOfPoints );
 
-		while( m_NumberOfPoints != 0 )
+		Point* point = other.head;
+
+		for( unsigned i = 0; i < other.m_NumberOfPoints; i++ )
 		{
-			deleteMe = head->previous;
-			head->previous = head->previous->previous;
+			insertBefore( head, point->x, point->y );
+			point = point->next;
+		}
 
-			delete deleteMe;
+		for( unsigned i = 0; i < other.children.size( ); i++ )
+		{
+			Polygon* child = new Polygon( *other.children[ i ] );
+			child->parent = this;
 
-			m_NumberOfPoints--;
+			children.push_back( child );
+			m_OwnedChildren.push_back( child );
 		}
-    }
+	}
+
+	void Polygon::release( )
+	{
+		// Pooled Points are released all at once by the pool
+		if( m_Pool == NULL )
+		{
+			Point* deleteMe;
+
+			while( m_NumberOfPoints != 0 )
+			{
+				deleteMe = head->previous;
+				head->previous = head->previous->previous;
+
+				deletePoint( deleteMe );
+
+				m_NumberOfPoints--;
+			}
+		}
+
+		head = NULL;
+		m_NumberOfPoints = 0;
+
+		for( unsigned i = 0; i < m_OwnedChildren.size( ); i++ )
+			delete m_OwnedChildren[ i ];
+
+		children.clear( );
+		m_OwnedChildren.clear( );
+	}
+
+    //--------------------------------------------------------------------------------------
+
+	Point* Polygon::newPoint( Scalar x, Scalar y )
+	{
+		if( m_Pool != NULL )
+			return m_Pool->allocate( x, y );
+
+		return new Point( x, y );
+	}
+
+	void Polygon::deletePoint( Point* point )
+	{
+		if( m_Pool != NULL )
+			m_Pool->release( point );
+		else
+			delete point;
+	}
 
     //--------------------------------------------------------------------------------------
 
@@ -155,6 +301,11 @@ namespace EarClipping
 		if( pos > children.size( ) )
 			return false;
 
+		std::vector< Polygon* >::iterator owned = std::find( m_OwnedChildren.begin( ), m_OwnedChildren.end( ), children[ pos ] );
+
+		if( owned != m_OwnedChildren.end( ) )
+			m_OwnedChildren.erase( owned );
+
 		delete children[ pos ];
 		children.erase( children.begin( ) + pos );
 	
@@ -163,11 +314,11 @@ namespace EarClipping
 
     //--------------------------------------------------------------------------------------
 
-    bool Polygon::addPoint( float x, float y )
+    bool Polygon::addPoint( Scalar x, Scalar y )
     {
 		if( head == NULL )
 		{
-			head = new Point( x, y );
+			head = newPoint( x, y );
 			head->next = head;
 			head->previous = head;
 
@@ -184,12 +335,12 @@ namespace EarClipping
             find = find->next;
 
             if( find == head ) break;
-        } while( find->x != x && find->y != y );
+        } while( find->x != x || find->y != y );
 
         // If point is not already in the Polygon
         if( ( find->x != x ) || ( find->y != y ) )
         {
-            find = new Point( x, y );
+            find = newPoint( x, y );
 
             find->next = head;
             find->previous = head->previous;
@@ -206,7 +357,108 @@ namespace EarClipping
 
     //--------------------------------------------------------------------------------------
 
-    bool Polygon::removePoint( float x, float y )
+	template< typename T >
+	unsigned Polygon::appendPoints( const T* xs, const T* ys, unsigned count, unsigned stride, bool checkDuplicates )
+	{
+		if( m_Pool != NULL )
+			m_Pool->reserve( count );
+
+		CoordinateSet seen;
+
+		if( checkDuplicates )
+		{
+			seen.reserve( m_NumberOfPoints + count );
+
+			Point* point = head;
+
+			for( unsigned i = 0; i < m_NumberOfPoints; i++ )
+			{
+				seen.insert( std::make_pair( point->x, point->y ) );
+				point = point->next;
+			}
+		}
+
+		unsigned added = 0;
+
+		for( unsigned i = 0; i < count; i++ )
+		{
+			Scalar x = static_cast< Scalar >( xs[ i * stride ] );
+			Scalar y = static_cast< Scalar >( ys[ i * stride ] );
+
+			if( checkDuplicates && !seen.insert( std::make_pair( x, y ) ).second )
+				continue;
+
+			// Before the head is the end of the list
+			insertBefore( head, x, y );
+			added++;
+		}
+
+		return added;
+	}
+
+	unsigned Polygon::addPoints( const float* xs, const float* ys, unsigned count, unsigned stride, bool checkDuplicates )
+	{
+		return appendPoints( xs, ys, count, stride, checkDuplicates );
+	}
+
+	unsigned Polygon::addPoints( const double* xs, const double* ys, unsigned count, unsigned stride, bool checkDuplicates )
+	{
+		return appendPoints( xs, ys, count, stride, checkDuplicates );
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	template< typename T >
+	unsigned Polygon::appendRings( const T* xs, const T* ys, unsigned stride, unsigned numPoints,
+		                           const uint32_t* ringStarts, unsigned numRings, bool checkDuplicates )
+	{
+		// Every ring must start inside the points and after the one before it
+		for( unsigned i = 0; i < numRings; i++ )
+		{
+			if( ringStarts[ i ] >= numPoints || ( i > 0 && ringStarts[ i ] <= ringStarts[ i - 1 ] ) )
+				return 0;
+		}
+
+		if( m_Pool != NULL )
+			m_Pool->reserve( numPoints );
+
+		unsigned added = 0;
+
+		for( unsigned i = 0; i < numRings; i++ )
+		{
+			uint32_t first = ringStarts[ i ];
+			uint32_t last = ( i + 1 < numRings ) ? ringStarts[ i + 1 ] : numPoints;
+
+			Polygon* ring = this;
+
+			if( i > 0 )
+			{
+				// The holes are created here, so they are deleted along with this Polygon
+				ring = new Polygon( this );
+				m_OwnedChildren.push_back( ring );
+			}
+
+			added += ring->appendPoints( xs + first * stride, ys + first * stride, last - first, stride, checkDuplicates );
+		}
+
+		return added;
+	}
+
+	unsigned Polygon::addRings( const float* xs, const float* ys, unsigned stride, unsigned numPoints,
+		                        const uint32_t* ringStarts, unsigned numRings, bool checkDuplicates )
+	{
+		return appendRings( xs, ys, stride, numPoints, ringStarts, numRings, checkDuplicates );
+	}
+
+	unsigned Polygon::addRings( const double* xs, const double* ys, unsigned stride, unsigned numPoints,
+		                        const uint32_t* ringStarts, unsigned numRings, bool checkDuplicates )
+	{
+		return appendRings( xs, ys, stride, numPoints, ringStarts, numRings, checkDuplicates );
+	}
+
+    //--------------------------------------------------------------------------------------
+
+    bool Polygon::removePoint( Scalar x, Scalar y )
     {
         if( m_NumberOfPoints == 0 )
             return false;
@@ -218,24 +470,10 @@ namespace EarClipping
             find = find->next;
 
             if( find == head ) break;
-        } while( find->x != x && find->y != y );
+        } while( find->x != x || find->y != y );
 
         if( find->x == x && find->y == y )
-        {
-            find->previous->next = find->next;
-            find->next->previous = find->previous;
-
-            if( head == find ) head = find->next;
-
-            delete( find );
-
-            m_NumberOfPoints--;
-
-			if( m_NumberOfPoints == 0 )
-				head = NULL;
-
-            return true;
-        }
+            return remove( find );
 
         return false;
     }
@@ -252,19 +490,7 @@ namespace EarClipping
         for( int i = 0; i < pos; i++ )
 			find = find->next;
 
-        find->previous->next = find->next;
-        find->next->previous = find->previous;
-
-        if( head == find ) head = find->next;
-
-        delete( find );
-
-        m_NumberOfPoints--;
-
-		if( m_NumberOfPoints == 0 )
-			head = NULL;
-
-        return true;
+        return remove( find );
     }
 
 	bool Polygon::removePoint( Point &point )
@@ -285,28 +511,34 @@ namespace EarClipping
         } while( find != head );
 
         if( find->x == point.x && find->y == point.y )
-        {
-            find->previous->next = find->next;
-            find->next->previous = find->previous;
+            return remove( find );
 
-            if( head == find ) head = find->next;
+		return false;
+	}
 
-            delete( find );
+	bool Polygon::remove( Point* point )
+	{
+		if( point == NULL || m_NumberOfPoints == 0 )
+			return false;
 
-            m_NumberOfPoints--;
+		point->previous->next = point->next;
+		point->next->previous = point->previous;
 
-			if( m_NumberOfPoints == 0 )
-				head = NULL;
+		if( head == point ) head = point->next;
 
-            return true;
-        }
+		deletePoint( point );
 
-		return false;
+		m_NumberOfPoints--;
+
+		if( m_NumberOfPoints == 0 )
+			head = NULL;
+
+		return true;
 	}
 
     //--------------------------------------------------------------------------------------
 
-	Point* Polygon::getPoint( float x, float y )
+	Point* Polygon::getPoint( Scalar x, Scalar y )
 	{
 		Point* find = head;
 
@@ -338,7 +570,7 @@ namespace EarClipping
 
 	//--------------------------------------------------------------------------------------
 
-	bool Polygon::insertPoint( float x, float y, Point* p_Point )
+	bool Polygon::insertPoint( Scalar x, Scalar y, Point* p_Point )
 	{
 		if( p_Point == NULL )
 			return false;
@@ -361,16 +593,75 @@ namespace EarClipping
 		if( find->x != p_Point->x && find->y != p_Point->y )
 				return false;
 
-		Point* newPoint = new Point( x, y );
+		Point* added = newPoint( x, y );
+
+		find->previous->next = added;
+		added->previous = find->previous;
+
+		find->previous = added;
+		added->next = find;
+
+		m_NumberOfPoints++;
+
+		return true;
+	}
+
+	Point* Polygon::insertBefore( Point* point, Scalar x, Scalar y )
+	{
+		Point* added = newPoint( x, y );
 
-		find->previous->next = newPoint;
-		newPoint->previous = find->previous;
+		if( point == NULL )
+		{
+			// Empty polygon; the new point becomes the head
+			added->next = added;
+			added->previous = added;
+			head = added;
+		}
+		else
+		{
+			point->previous->next = added;
+			added->previous = point->previous;
 
-		find->previous = newPoint;
-		newPoint->next = find;
+			point->previous = added;
+			added->next = point;
+		}
 
 		m_NumberOfPoints++;
 
+		return added;
+	}
+
+	bool Polygon::splice( Point* point, Polygon &ring, Point* start )
+	{
+		if( &ring == this || ring.m_NumberOfPoints == 0 || ring.m_Pool != m_Pool )
+			return false;
+
+		if( start == NULL )
+			start = ring.head;
+
+		Point* last = start->previous;
+
+		if( point == NULL )
+		{
+			// Empty polygon; the ring is taken over as is
+			head = start;
+		}
+		else
+		{
+			Point* after = point->next;
+
+			point->next = start;
+			start->previous = point;
+
+			last->next = after;
+			after->previous = last;
+		}
+
+		m_NumberOfPoints += ring.m_NumberOfPoints;
+
+		ring.head = NULL;
+		ring.m_NumberOfPoints = 0;
+
 		return true;
 	}
 
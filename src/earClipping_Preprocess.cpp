@@ -0,0 +1,195 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2018 Steven T Sell (ssell@vertexfragment.com)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "earClipping_Core.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//------------------------------------------------------------------------------------------
+
+namespace EarClipping
+{
+#if defined( EAR_CLIPPING_INT32 )
+	typedef WideScalar CrossScalar;		// exact for int32 coordinates
+#else
+	typedef double CrossScalar;
+#endif
+
+	PreprocessStats::PreprocessStats( )
+		: numRings( 0 ),
+		  numReversed( 0 ),
+		  numWelded( 0 ),
+		  numCollinear( 0 ),
+		  numDegenerate( 0 ),
+		  minX( std::numeric_limits< double >::infinity( ) ),
+		  minY( std::numeric_limits< double >::infinity( ) ),
+		  maxX( -std::numeric_limits< double >::infinity( ) ),
+		  maxY( -std::numeric_limits< double >::infinity( ) )
+	{
+
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Returns TRUE if the two Points lie within epsilon of each other on both axes.
+	 */
+	bool isWeld( const Point* a, const Point* b, double epsilon )
+	{
+		return ( std::fabs( static_cast< double >( a->x ) - b->x ) <= epsilon ) &&
+		       ( std::fabs( static_cast< double >( a->y ) - b->y ) <= epsilon );
+	}
+
+	/**
+	 * \brief Returns TRUE if b lies on the line through a and c, including when it doubles back.
+	 */
+	bool isCollinear( const Point* a, const Point* b, const Point* c )
+	{
+		CrossScalar abx = static_cast< CrossScalar >( b->x ) - a->x;
+		CrossScalar aby = static_cast< CrossScalar >( b->y ) - a->y;
+		CrossScalar bcx = static_cast< CrossScalar >( c->x ) - b->x;
+		CrossScalar bcy = static_cast< CrossScalar >( c->y ) - b->y;
+
+		return ( abx * bcy ) == ( aby * bcx );
+	}
+
+	/**
+	 * \brief Runs the preprocessing pass over a single ring.
+	 *
+	 * Each Point is read once, in order. A Point welded to the last one kept is removed
+	 * straight away, and the last one kept is removed while it lies in line with its
+	 * neighbours. Only Points behind the walk are removed, so the walk can carry on from
+	 * the successor it read ahead. The area and bounds are taken from the Points as read;
+	 * removing duplicates and collinear Points does not change them.
+	 */
+	void preprocessRing( Polygon &ring, double weldEpsilon, bool removeCollinear, PreprocessStats &stats )
+	{
+		unsigned count = ring.numPoints( );
+
+		if( count == 0 )
+			return;
+
+		stats.numRings++;
+
+		Point* active = ring.get( );
+		double area = 0;
+
+		for( unsigned i = 0; i < count; i++ )
+		{
+			Point* next = active->next;
+
+			stats.minX = std::min( stats.minX, static_cast< double >( active->x ) );
+			stats.minY = std::min( stats.minY, static_cast< double >( active->y ) );
+			stats.maxX = std::max( stats.maxX, static_cast< double >( active->x ) );
+			stats.maxY = std::max( stats.maxY, static_cast< double >( active->y ) );
+
+			area += ( static_cast< double >( active->x ) * next->y ) - ( static_cast< double >( next->x ) * active->y );
+
+			if( active != ring.get( ) )
+			{
+				Point* last = active->previous;
+
+				if( isWeld( last, active, weldEpsilon ) )
+				{
+					ring.remove( active );
+					stats.numWelded++;
+				}
+				else if( removeCollinear )
+				{
+					// The head is settled once the walk has come back around to it
+					while( ( last != ring.get( ) ) && isCollinear( last->previous, last, active ) )
+					{
+						last = last->previous;
+						ring.remove( last->next );
+						stats.numCollinear++;
+					}
+				}
+			}
+
+			active = next;
+		}
+
+		//--------------------------------------------
+		// Close the seam between the last Point kept and the head
+
+		bool changed = true;
+
+		while( changed && ( ring.numPoints( ) >= 3 ) )
+		{
+			Point* head = ring.get( );
+			Point* tail = head->previous;
+
+			if( isWeld( tail, head, weldEpsilon ) )
+			{
+				ring.remove( tail );
+				stats.numWelded++;
+			}
+			else if( removeCollinear && isCollinear( tail->previous, tail, head ) )
+			{
+				ring.remove( tail );
+				stats.numCollinear++;
+			}
+			else if( removeCollinear && isCollinear( tail, head, head->next ) )
+			{
+				ring.remove( head );
+				stats.numCollinear++;
+			}
+			else
+				changed = false;
+		}
+
+		if( ring.numPoints( ) < 3 )
+		{
+			stats.numDegenerate++;
+			return;
+		}
+
+		// Negative, the ring is clockwise
+		if( area < 0 )
+		{
+			ring.reverse( -1 );
+			stats.numReversed++;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	PreprocessStats preprocessPolygon( Polygon* poly, double weldEpsilon, bool removeCollinear )
+	{
+		PreprocessStats stats;
+
+		if( poly == NULL )
+			return stats;
+
+		preprocessRing( *poly, weldEpsilon, removeCollinear, stats );
+
+		for( unsigned i = 0; i < poly->numChildren( ); i++ )
+			preprocessRing( *poly->getChild( i ), weldEpsilon, removeCollinear, stats );
+
+		return stats;
+	}
+};
@@ -24,13 +24,301 @@
  
 #include "earClipping_Core.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <string>
+#include <thread>
+
+// Floats are parsed with std::from_chars where the standard library has it, and strtof otherwise
+#if ( __cplusplus >= 201703L ) || ( defined( _MSVC_LANG ) && _MSVC_LANG >= 201703L )
+#include <charconv>
+#endif
 
 //------------------------------------------------------------------------------------------
 
 namespace EarClipping
 {
+	/// Smallest part of an ear file worth handing to a thread of its own
+	const size_t EAR_FILE_CHUNK_SIZE = 1 << 20;
+
+	/**
+	 * \brief A newline-aligned run of lines of an ear file, counted and parsed by one thread.
+	 */
+	struct EarChunk
+	{
+		const char* begin;
+		const char* end;
+
+		unsigned firstLine;					// line number of the first line in the file
+		unsigned firstEar;					// ears on the lines before the chunk
+		unsigned numLines;
+		unsigned numEars;
+
+		std::vector< unsigned > badLines;
+	};
+
+	//--------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Returns the end of the line starting at begin, not counting the newline or a carriage return before it.
+	 */
+	const char* lineEnd( const char* begin, const char* end, const char* &next )
+	{
+		const char* newline = static_cast< const char* >( std::memchr( begin, '\n', end - begin ) );
+
+		next = newline != NULL ? newline + 1 : end;
+
+		const char* last = newline != NULL ? newline : end;
+
+		if( last != begin && *( last - 1 ) == '\r' )
+			last--;
+
+		return last;
+	}
+
+	/**
+	 * \brief Reads a single coordinate at cursor, moving it past the value.
+	 */
+	bool parseCoordinate( const char* &cursor, const char* end, float &value )
+	{
+#if defined( __cpp_lib_to_chars )
+		std::from_chars_result result = std::from_chars( cursor, end, value );
+
+		if( result.ec != std::errc( ) )
+			return false;
+
+		cursor = result.ptr;
+#else
+		// strtof needs a terminated string; coordinates are short, so copy to the stack
+		char buffer[ 64 ];
+		size_t length = 0;
+
+		while( cursor + length != end && length < sizeof( buffer ) - 1 && cursor[ length ] != ',' && cursor[ length ] != ':' )
+		{
+			buffer[ length ] = cursor[ length ];
+			length++;
+		}
+
+		buffer[ length ] = '\0';
+
+		char* parsed;
+		value = std::strtof( buffer, &parsed );
+
+		if( parsed == buffer || parsed != buffer + length )
+			return false;
+
+		cursor += length;
+#endif
+
+		return true;
+	}
+
+	/**
+	 * \brief Parses a line of the form X1,Y1:X2,Y2:X3,Y3 into the six values of ear.
+	 */
+	bool parseEar( const char* begin, const char* end, float* ear )
+	{
+		const char separators[ 5 ] = { ',', ':', ',', ':', ',' };
+
+		for( unsigned i = 0; i < 6; i++ )
+		{
+			if( !parseCoordinate( begin, end, ear[ i ] ) )
+				return false;
+
+			if( i < 5 )
+			{
+				if( begin == end || *begin != separators[ i ] )
+					return false;
+
+				begin++;
+			}
+		}
+
+		return begin == end;
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Counts the lines of the chunk and the ones holding an ear (every line that is not blank).
+	 */
+	void countEarLines( EarChunk* chunk )
+	{
+		const char* next;
+
+		for( const char* line = chunk->begin; line != chunk->end; line = next )
+		{
+			const char* last = lineEnd( line, chunk->end, next );
+
+			chunk->numLines++;
+
+			if( last != line )
+				chunk->numEars++;
+		}
+	}
+
+	/**
+	 * \brief Parses every ear of the chunk into its place in ears, which has room for numEars.
+	 */
+	void parseEarLines( EarChunk* chunk, float* ears, unsigned numEars )
+	{
+		const char* next;
+
+		unsigned lineNumber = chunk->firstLine;
+		unsigned ear = chunk->firstEar;
+
+		for( const char* line = chunk->begin; line != chunk->end; line = next, lineNumber++ )
+		{
+			const char* last = lineEnd( line, chunk->end, next );
+
+			if( last == line )
+				continue; // blank
+
+			// Ears beyond the count given by the header have nowhere to go
+			if( ear >= numEars )
+			{
+				chunk->badLines.push_back( lineNumber );
+			}
+			else
+			{
+				// Parsed aside so a line failing partway leaves its ear as zeros
+				float values[ 6 ];
+
+				if( parseEar( line, last, values ) )
+					std::memcpy( &ears[ ear * 6 ], values, sizeof( values ) );
+				else
+					chunk->badLines.push_back( lineNumber );
+			}
+
+			ear++;
+		}
+	}
+
+	/**
+	 * \brief Runs work on every chunk, one thread each; the first chunk is run on the calling thread.
+	 */
+	template< typename Work >
+	void runEarChunks( std::vector< EarChunk > &chunks, Work work )
+	{
+		std::vector< std::thread > threads;
+
+		for( unsigned i = 1; i < chunks.size( ); i++ )
+			threads.push_back( std::thread( work, &chunks[ i ] ) );
+
+		work( &chunks[ 0 ] );
+
+		for( unsigned i = 0; i < threads.size( ); i++ )
+			threads[ i ].join( );
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	bool readEars( const char* path, std::vector< float > &ears, std::vector< unsigned > &badLines, unsigned numThreads )
+	{
+		ears.clear( );
+		badLines.clear( );
+
+		MappedFile file;
+
+		if( !file.open( path ) )
+			return false;
+
+		const char* begin = file.data( );
+		const char* end = begin + file.size( );
+
+		//--------------------------------------------
+		// Header: the number of ears in the file
+
+		const char* body;
+		const char* last = lineEnd( begin, end, body );
+
+		unsigned long long count = 0;
+		const char* digit = begin;
+
+		for( ; digit != last && *digit >= '0' && *digit <= '9'; digit++ )
+			count = std::min( count * 10 + ( *digit - '0' ), 0xFFFFFFFFull );
+
+		if( digit == begin || digit != last || count > 0xFFFFFFFFull / 6 )
+		{
+			badLines.push_back( 1 );
+			return false;
+		}
+
+		unsigned numEars = static_cast< unsigned >( count );
+
+		// The shortest ear line is "a,b:c,d:e,f\n", so the file cannot hold more ears than
+		// this; a larger count is a short file and must not be allocated for up front
+		unsigned capacity = static_cast< unsigned >( std::min< size_t >( numEars, ( static_cast< size_t >( end - body ) + 1 ) / 12 ) );
+
+		ears.resize( static_cast< size_t >( capacity ) * 6 );
+
+		//--------------------------------------------
+		// Split the rest into newline-aligned chunks
+
+		if( numThreads == 0 )
+			numThreads = std::max( std::thread::hardware_concurrency( ), 1u );
+
+		size_t length = end - body;
+
+		numThreads = static_cast< unsigned >( std::max< size_t >( std::min< size_t >( numThreads, length / EAR_FILE_CHUNK_SIZE ), 1 ) );
+
+		std::vector< EarChunk > chunks( numThreads );
+
+		const char* start = body;
+
+		for( unsigned i = 0; i < numThreads; i++ )
+		{
+			const char* stop = end;
+
+			if( i + 1 < numThreads )
+			{
+				stop = std::max( start, body + ( length / numThreads ) * ( i + 1 ) );
+				lineEnd( stop, end, stop );
+			}
+
+			chunks[ i ].begin = start;
+			chunks[ i ].end = stop;
+			chunks[ i ].numLines = 0;
+			chunks[ i ].numEars = 0;
+
+			start = stop;
+		}
+
+		//--------------------------------------------
+		// Count the lines of each chunk, then parse each into its place
+
+		runEarChunks( chunks, countEarLines );
+
+		unsigned lines = 2;
+		unsigned found = 0;
+
+		for( unsigned i = 0; i < chunks.size( ); i++ )
+		{
+			chunks[ i ].firstLine = lines;
+			chunks[ i ].firstEar = found;
+
+			lines += chunks[ i ].numLines;
+			found += chunks[ i ].numEars;
+		}
+
+		float* output = ears.empty( ) ? NULL : &ears[ 0 ];
+
+		runEarChunks( chunks, [ output, capacity ]( EarChunk* chunk ){ parseEarLines( chunk, output, capacity ); } );
+
+		for( unsigned i = 0; i < chunks.size( ); i++ )
+			badLines.insert( badLines.end( ), chunks[ i ].badLines.begin( ), chunks[ i ].badLines.end( ) );
+
+		// Fewer ears than the header promised; keep only those read
+		if( found < capacity )
+			ears.resize( static_cast< size_t >( found ) * 6 );
+
+		return badLines.empty( ) && found == numEars;
+	}
+
+	//--------------------------------------------------------------------------------------
+
 	std::vector< float > retrieveEars( char* path )
 	{
 		std::ifstream file( path );
@@ -94,12 +382,12 @@ namespace EarClipping
 					find3 == std::string::npos )
 					return ears;
 
-				ears.push_back( atoi( p0.substr( 0, find1 ).c_str( ) ) );
-				ears.push_back( atoi( p0.substr( find1 + 1 ).c_str( ) ) );
-				ears.push_back( atoi( p1.substr( 0, find2 ).c_str( ) ) );
-				ears.push_back( atoi( p1.substr( find2 + 1 ).c_str( ) ) );
-				ears.push_back( atoi( p2.substr( 0, find3 ).c_str( ) ) );
-				ears.push_back( atoi( p2.substr( find3 + 1 ).c_str( ) ) );
+				ears.push_back( atof( p0.substr( 0, find1 ).c_str( ) ) );
+				ears.push_back( atof( p0.substr( find1 + 1 ).c_str( ) ) );
+				ears.push_back( atof( p1.substr( 0, find2 ).c_str( ) ) );
+				ears.push_back( atof( p1.substr( find2 + 1 ).c_str( ) ) );
+				ears.push_back( atof( p2.substr( 0, find3 ).c_str( ) ) );
+				ears.push_back( atof( p2.substr( find3 + 1 ).c_str( ) ) );
 
 				cntr++;
 			}
@@ -0,0 +1,155 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2018 Steven T Sell (ssell@vertexfragment.com)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "earClipping_Core.h"
+
+//------------------------------------------------------------------------------------------
+
+namespace EarClipping
+{
+	/**
+	 * \brief Returns TRUE if the corner at b of the counter-clockwise triangle abc turns left.
+	 */
+	inline bool isLeftCorner( const Scalar* a, const Scalar* b, const Scalar* c )
+	{
+		return ( ( static_cast< WideScalar >( a[ 0 ] ) * ( c[ 1 ] - b[ 1 ] ) ) +
+		         ( static_cast< WideScalar >( b[ 0 ] ) * ( a[ 1 ] - c[ 1 ] ) ) +
+		         ( static_cast< WideScalar >( c[ 0 ] ) * ( b[ 1 ] - a[ 1 ] ) ) ) < 0;
+	}
+
+	/**
+	 * \brief Returns TRUE if the point lies inside (or on the edge of) the counter-clockwise triangle abc.
+	 *
+	 * Points matching one of the corners are ignored, as in the general ear test.
+	 */
+	inline bool inSmallTriangle( const Scalar* p, const Scalar* a, const Scalar* b, const Scalar* c )
+	{
+		if( ( p[ 0 ] == a[ 0 ] && p[ 1 ] == a[ 1 ] ) ||
+			( p[ 0 ] == b[ 0 ] && p[ 1 ] == b[ 1 ] ) ||
+			( p[ 0 ] == c[ 0 ] && p[ 1 ] == c[ 1 ] ) )
+			return false;
+
+		return ( ( static_cast< WideScalar >( b[ 0 ] ) - a[ 0 ] ) * ( static_cast< WideScalar >( p[ 1 ] ) - a[ 1 ] ) -
+		         ( static_cast< WideScalar >( b[ 1 ] ) - a[ 1 ] ) * ( static_cast< WideScalar >( p[ 0 ] ) - a[ 0 ] ) >= 0 ) &&
+		       ( ( static_cast< WideScalar >( c[ 0 ] ) - b[ 0 ] ) * ( static_cast< WideScalar >( p[ 1 ] ) - b[ 1 ] ) -
+		         ( static_cast< WideScalar >( c[ 1 ] ) - b[ 1 ] ) * ( static_cast< WideScalar >( p[ 0 ] ) - b[ 0 ] ) >= 0 ) &&
+		       ( ( static_cast< WideScalar >( a[ 0 ] ) - c[ 0 ] ) * ( static_cast< WideScalar >( p[ 1 ] ) - c[ 1 ] ) -
+		         ( static_cast< WideScalar >( a[ 1 ] ) - c[ 1 ] ) * ( static_cast< WideScalar >( p[ 0 ] ) - c[ 0 ] ) >= 0 );
+	}
+
+	//------------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Clips the ears of a ring of exactly N points, held in a fixed array on the stack.
+	 *
+	 * With N known at compile time every loop has a constant bound and is unrolled. Each pass
+	 * clips the first ear found: a left-turning corner with none of the other remaining
+	 * points inside it. Returns the number of ears written, stopping early if the ring runs
+	 * out of ears (degenerate input).
+	 */
+	template< unsigned N >
+	unsigned clipSmall( const Scalar* vertices, uint32_t* indices )
+	{
+		uint32_t ring[ N ];
+
+		for( uint32_t i = 0; i < N; i++ )
+			ring[ i ] = i;
+
+		unsigned remaining = N;
+		unsigned ears = 0;
+
+		for( unsigned pass = 0; pass < N - 2; pass++ )
+		{
+			unsigned tip = N;
+
+			for( unsigned k = 0; ( k < N ) && ( k < remaining ) && ( tip == N ); k++ )
+			{
+				const Scalar* a = &vertices[ ring[ ( k + remaining - 1 ) % remaining ] * 2 ];
+				const Scalar* b = &vertices[ ring[ k ] * 2 ];
+				const Scalar* c = &vertices[ ring[ ( k + 1 ) % remaining ] * 2 ];
+
+				if( !isLeftCorner( a, b, c ) )
+					continue;
+
+				bool ear = true;
+
+				for( unsigned j = 0; ( j < N ) && ( j < remaining ) && ear; j++ )
+					ear = !inSmallTriangle( &vertices[ ring[ j ] * 2 ], a, b, c );
+
+				if( ear )
+					tip = k;
+			}
+
+			if( tip == N )
+				break;
+
+			indices[ ears * 3 + 0 ] = ring[ ( tip + remaining - 1 ) % remaining ];
+			indices[ ears * 3 + 1 ] = ring[ tip ];
+			indices[ ears * 3 + 2 ] = ring[ ( tip + 1 ) % remaining ];
+
+			ears++;
+
+			// remove ear tip from the ring
+			for( unsigned k = tip; ( k + 1 < N ) && ( k + 1 < remaining ); k++ )
+				ring[ k ] = ring[ k + 1 ];
+
+			remaining--;
+		}
+
+		return ears;
+	}
+
+	/**
+	 * \brief Triangles need no search; the corner is only checked for being counter-clockwise.
+	 */
+	template< >
+	unsigned clipSmall< 3 >( const Scalar* vertices, uint32_t* indices )
+	{
+		if( !isLeftCorner( &vertices[ 0 ], &vertices[ 2 ], &vertices[ 4 ] ) )
+			return 0;
+
+		indices[ 0 ] = 0;
+		indices[ 1 ] = 1;
+		indices[ 2 ] = 2;
+
+		return 1;
+	}
+
+	//------------------------------------------------------------------------------------------
+
+	unsigned triangulateSmall( const Scalar* vertices, unsigned numPoints, uint32_t* indices )
+	{
+		switch( numPoints )
+		{
+		case 3: return clipSmall< 3 >( vertices, indices );
+		case 4: return clipSmall< 4 >( vertices, indices );
+		case 5: return clipSmall< 5 >( vertices, indices );
+		case 6: return clipSmall< 6 >( vertices, indices );
+		case 7: return clipSmall< 7 >( vertices, indices );
+		case 8: return clipSmall< 8 >( vertices, indices );
+		default: return 0;
+		}
+	}
+};
@@ -27,6 +27,10 @@
 
 //------------------------------------------------------------------------------------------
 
+#include <cstddef>
+#include <functional>
+#include <stdint.h>
+#include <utility>
 #include <vector>
 
 //------------------------------------------------------------------------------------------
@@ -38,6 +42,29 @@
 namespace EarClipping
 {
 
+    //--------------------------------------------------------------------------------------
+    // Coordinate type
+    //
+    // Selected at compile time by defining one of the following project-wide:
+    //
+    //     (nothing)               float
+    //     EAR_CLIPPING_DOUBLE     double
+    //     EAR_CLIPPING_INT32      int32_t; exact, with all products taken in 64-bits.
+    //                             Coordinates must lie within [-2^30, 2^30).
+    //
+    // WideScalar is the type products of two coordinate differences are computed in.
+
+#if defined( EAR_CLIPPING_DOUBLE )
+	typedef double Scalar;
+	typedef double WideScalar;
+#elif defined( EAR_CLIPPING_INT32 )
+	typedef int32_t Scalar;
+	typedef int64_t WideScalar;
+#else
+	typedef float Scalar;
+	typedef float WideScalar;
+#endif
+
     //--------------------------------------------------------------------------------------
     // Point
 
@@ -47,25 +74,26 @@ namespace EarClipping
 	 * \author ssell
 	 *
 	 * Contains fields for x and y-values as well as methods for calculating dot/cross products.
+	 * The products are returned as WideScalar so that they are exact for integer coordinates.
 	 * The points form a doubly-linked circular list.
 	 */
     struct Point
     {
-        Point( float pX, float pY )
+        Point( Scalar pX, Scalar pY )
             : x( pX ), y( pY ), next( NULL ), previous( NULL ) { }
 
         Point( )
             : next( NULL ), previous( NULL ) { }
 
 		///  returns a vector perpendicular to the pair of two-dimensional vectors
-		float cross( Point rhs ){ return ( this->x * rhs.y ) - ( this->y * rhs.x ); }
+		WideScalar cross( Point rhs ){ return ( static_cast< WideScalar >( this->x ) * rhs.y ) - ( static_cast< WideScalar >( this->y ) * rhs.x ); }
 
 		/// cosine of the angle between the pair of two-dimensional vectors
-		float dot( Point rhs ){ return ( this->x * rhs.x ) + ( this->y * rhs.y ); }
+		WideScalar dot( Point rhs ){ return ( static_cast< WideScalar >( this->x ) * rhs.x ) + ( static_cast< WideScalar >( this->y ) * rhs.y ); }
 
         //--------------------------------------------
 
-        float x, y;
+        Scalar x, y;
 
         Point* next;
         Point* previous;
@@ -79,6 +107,84 @@ namespace EarClipping
 		Point operator+( const Point rhs ){ return Point( this->x + rhs.x, this->y + rhs.y ); }
     };
 
+	/**
+	 * \struct CoordinateHash
+	 * \brief Hashes an X,Y pair, for sets and maps keyed by position.
+	 */
+	struct CoordinateHash
+	{
+		size_t operator( )( const std::pair< Scalar, Scalar > &coordinate ) const
+		{
+			size_t hash = std::hash< Scalar >( )( coordinate.first );
+			return hash ^ ( std::hash< Scalar >( )( coordinate.second ) + 0x9e3779b9 + ( hash << 6 ) + ( hash >> 2 ) );
+		}
+	};
+
+    //--------------------------------------------------------------------------------------
+    // PointPool
+    // source: earClipping_PointPool.cpp
+
+	/**
+	 * \class PointPool
+	 * \brief Arena the Points of one or more Polygons can be allocated from.
+	 *
+	 * Points are carved out of large blocks one after the other. Points removed from a
+	 * Polygon go to a free list and are handed out again first. A Polygon using a pool does
+	 * not free its Points when destroyed; instead they are all released at once by reset or
+	 * by destroying the pool. The blocks themselves are kept by reset, so one pool can be
+	 * reused job after job without going back to the heap.
+	 *
+	 * A pool is not thread-safe. Use one pool per thread.
+	 */
+	class PointPool
+	{
+
+	public:
+
+		/// pointsPerBlock is the number of Points allocated from the heap at a time
+		PointPool( unsigned pointsPerBlock = 4096 );
+
+		/// Frees all blocks. No Polygon using the pool may be used afterwards.
+		~PointPool( );
+
+		Point* allocate( Scalar x, Scalar y );
+
+		/// Returns the Point to the pool so it can be handed out again
+		void release( Point* point );
+
+		/**
+		 * Releases every Point allocated from the pool while keeping the blocks.
+		 * Polygons using the pool must be destroyed (or no longer used) before this is called.
+		 */
+		void reset( );
+
+		/// Allocates enough blocks up front for the next count Points to be handed out without going to the heap
+		void reserve( unsigned count );
+
+		/// Number of Points currently handed out
+		inline unsigned numAllocated( ){ return m_NumberAllocated; }
+
+	private:
+
+		// Not copyable; the blocks are owned by the pool
+		PointPool( const PointPool& );
+		PointPool& operator=( const PointPool& );
+
+		std::vector< Point* > m_Blocks;
+
+		unsigned m_BlockSize;
+
+		/// Block currently being carved up and the number of Points already taken from it
+		unsigned m_CurrentBlock;
+		unsigned m_BlockUsed;
+
+		/// Released Points, chained through Point::next
+		Point* m_FreeList;
+
+		unsigned m_NumberAllocated;
+
+	};
+
     //--------------------------------------------------------------------------------------
     // Polygon
     // source: earClipping_Polygon.cpp
@@ -98,57 +204,122 @@ namespace EarClipping
     public:
 
         /// Creates 3 Points with the Polygon and assigns the Parent polygon (NULL if no parent)
-        Polygon( Polygon *p_Parent, float xA, float yA, float xB, float yB, float xC, float yC );
-		Polygon( Polygon *p_Parent, float xA, float yA, float xB, float yB );
-		Polygon( Polygon *p_Parent, float xA, float yA );
+        Polygon( Polygon *p_Parent, Scalar xA, Scalar yA, Scalar xB, Scalar yB, Scalar xC, Scalar yC );
+		Polygon( Polygon *p_Parent, Scalar xA, Scalar yA, Scalar xB, Scalar yB );
+		Polygon( Polygon *p_Parent, Scalar xA, Scalar yA );
 		Polygon( );
 
         /// Creates an empty Polygon with specified Parent (NULL if no parent)
         Polygon( Polygon *p_Parent );
 
-        /// Deletes all Points existing directly within Polygon. Does not touch child Polygons.
+		/**
+		 * Creates an empty Polygon whose Points are allocated from the pool (NULL for the heap).
+		 * Children created with this Polygon as their parent use the same pool.
+		 */
+		Polygon( Polygon *p_Parent, PointPool *pool );
+
+		/**
+		 * Deep copy. Every Point is copied (from the same pool as other, if any) and so is every
+		 * child, recursively. The copied children belong to the copy and are deleted with it;
+		 * children attached to the copy later are not. The copy has no parent.
+		 */
+		Polygon( const Polygon &other );
+
+		/// Takes over the Points and children of other, which is left empty. Nothing is copied. The new Polygon has no parent.
+		Polygon( Polygon &&other );
+
+		/// Releases the current Points (and any children owned by this Polygon) and deep copies other. The parent is kept.
+		Polygon& operator=( const Polygon &other );
+		Polygon& operator=( Polygon &&other );
+
+        /// Deletes all Points existing directly within Polygon, and any children it created itself (see the copy constructor and addRings). Does not touch pooled Points.
         ~Polygon( );
 
         /// Adds a child (interior/hole) polygon to this polygon
         bool addChild( Polygon *child );
 
         /// Return true if point was added. False if adding failed (point already exists in Polygon)
-        bool addPoint( float x, float y );
+        bool addPoint( Scalar x, Scalar y );
+
+		/**
+		 * Appends count points read from xs and ys, stepping stride values from one point to the
+		 * next: ( xy, xy + 1, count, 2 ) reads interleaved X,Y pairs and ( xs, ys, count, 1 ) reads
+		 * separate arrays. As with addPoint, points already in the Polygon are skipped; this is
+		 * checked with a hash set so the whole load is linear. If checkDuplicates is false the
+		 * caller vouches for the input and every point is added. Returns the number of points added.
+		 */
+		unsigned addPoints( const float* xs, const float* ys, unsigned count, unsigned stride = 1, bool checkDuplicates = true );
+		unsigned addPoints( const double* xs, const double* ys, unsigned count, unsigned stride = 1, bool checkDuplicates = true );
+
+		/**
+		 * Loads the Polygon and its holes from numPoints points laid out as for addPoints.
+		 * ringStarts holds the first point of each of the numRings rings; the first ring is
+		 * appended to this Polygon and each one after it becomes a new child Polygon (sharing
+		 * this Polygon's pool). For pooled Polygons every Point is reserved up front.
+		 * The holes are owned by this Polygon and deleted along with it, so they should not be
+		 * deleted by the caller. Children attached in any other way are left to the caller.
+		 * ringStarts must be strictly increasing and below numPoints; if it is not, nothing
+		 * is added. Returns the number of points added.
+		 */
+		unsigned addRings( const float* xs, const float* ys, unsigned stride, unsigned numPoints,
+			               const uint32_t* ringStarts, unsigned numRings, bool checkDuplicates = true );
+		unsigned addRings( const double* xs, const double* ys, unsigned stride, unsigned numPoints,
+			               const uint32_t* ringStarts, unsigned numRings, bool checkDuplicates = true );
 
         /// Return true if point was removed. False if point DNE in Polygon (including if Polygon is empty)
-        bool removePoint( float x, float y );
+        bool removePoint( Scalar x, Scalar y );
 		/// Removes the point at the specified location in the list
 		bool removePoint( unsigned pos );
 		bool removePoint( Point &point ); //this is a cop-out to simplifiy the triangulation
 
         /// Return head point in Polygon
-        Point* get( ){ return head; }
+        Point* get( ) const { return head; }
 		Polygon* getChild( unsigned pos ){ if( children.size( ) > pos && pos != -1 ) return children[ pos ]; else return NULL; }
 		bool removeChild( unsigned pos );
 
         std::vector< Polygon* > getChildren( ){ return children; }
 
 		///Find a specific point
-		Point* getPoint( float x, float y );
+		Point* getPoint( Scalar x, Scalar y );
 
 		/// Returns the point at the specified position in the list
 		Point* getPoint( unsigned position );
 
 		/// Number of points currently comprising the polygon.
-		inline unsigned numPoints( ){ return m_NumberOfPoints; }
-		inline unsigned numChildren( ){ return children.size( ); }
+		inline unsigned numPoints( ) const { return m_NumberOfPoints; }
+		inline unsigned numChildren( ) const { return children.size( ); }
 
 		/**
 		 * Creates a new Point at location of p_Point->previous. Returns TRUE if Point already exists in Polygon.<br>
 		 * Insert allows for multiple copies of the same data point, unlike addPoint
 		 */
-		bool insertPoint( float x, float y, Point* p_Point );
+		bool insertPoint( Scalar x, Scalar y, Point* p_Point );
+
+		/// Creates a new Point directly before point, which must belong to this Polygon, and returns it. No search is done.
+		Point* insertBefore( Point* point, Scalar x, Scalar y );
+
+		/// Unlinks and deletes point, which must belong to this Polygon. No search is done.
+		bool remove( Point* point );
+
+		/**
+		 * Moves every Point of ring into this Polygon directly after point, beginning with start and
+		 * following next. Nothing is copied, and ring is left empty. Returns FALSE if the two do not
+		 * share a pool, in which case nothing is moved.
+		 */
+		bool splice( Point* point, Polygon &ring, Point* start );
 
 		/// If pos == -1, reverse the order of the points of the polygon. Else reverses order of child with index pos.
 		void reverse( int pos );
 
+		/// Pool the Points are allocated from. NULL if they come from the heap.
+		inline PointPool* getPool( ){ return m_Pool; }
+
     protected:
 
+		/// Allocates a Point from the pool, or the heap if there is none
+		Point* newPoint( Scalar x, Scalar y );
+		void deletePoint( Point* point );
+
         /// Head of the Point doubly-linked, circular, linked-list
         Point* head;
 
@@ -158,7 +329,25 @@ namespace EarClipping
         /// Number of Points directly associated with this Polygon. Does not include interior Points
         unsigned m_NumberOfPoints;
 
-		bool isDuplicate( float x, float y );
+		bool isDuplicate( Scalar x, Scalar y );
+
+		/// Appends copies of the Points and children of other
+		void copyFrom( const Polygon &other );
+
+		/// Deletes the Points, and the children if they are owned, leaving the Polygon empty
+		void release( );
+
+		/// Children created by this Polygon (copies and the holes of addRings), which are deleted along with it
+		std::vector< Polygon* > m_OwnedChildren;
+
+		template< typename T >
+		unsigned appendPoints( const T* xs, const T* ys, unsigned count, unsigned stride, bool checkDuplicates );
+
+		template< typename T >
+		unsigned appendRings( const T* xs, const T* ys, unsigned stride, unsigned numPoints,
+			                  const uint32_t* ringStarts, unsigned numRings, bool checkDuplicates );
+
+		PointPool* m_Pool;
 
     private:
 
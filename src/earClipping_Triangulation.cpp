@@ -24,60 +24,381 @@
  
 #include "earClipping_Core.h"
 
-#include <fstream>
+#include <algorithm>
 #include <iostream>
-#include <string>
+#include <unordered_map>
+
+// SSE2 is part of every x86-64 target. Define EAR_CLIPPING_NO_SIMD to force the scalar kernel.
+// The vector kernels are only used for float coordinates.
+#if !defined( EAR_CLIPPING_NO_SIMD ) && !defined( EAR_CLIPPING_DOUBLE ) && !defined( EAR_CLIPPING_INT32 ) && \
+    ( defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) )
+#define EAR_CLIPPING_SSE2
+#include <emmintrin.h>
+
+// The AVX2 kernel is compiled alongside and only picked if the CPU supports it
+#if defined( __GNUC__ ) || ( defined( _MSC_VER ) && _MSC_VER >= 1800 )
+#define EAR_CLIPPING_AVX2
+#include <immintrin.h>
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+#endif
+#endif
+
 //------------------------------------------------------------------------------------------
 
 namespace EarClipping
 {
-	bool inTriangle( Point pointToCheck, Point earTip, Point earTipPlusOne, Point earTipMinusOne )
+	/**
+	 * \brief Returns TRUE if the point lies inside (or on the edge of) the counter-clockwise ear.
+	 *
+	 * The point is tested against the three edge functions of the triangle instead of solving
+	 * for its barycentric coordinates, which needs no divisions. Points matching one of the
+	 * corners are ignored, as these are duplicates of the ear's own points.
+	 * The vectorized kernels below perform exactly the same operations per lane, and for
+	 * integer coordinates the test is exact.
+	 */
+	bool inTriangle( const Scalar* pointToCheck, const Scalar* earTip, const Scalar* earTipPlusOne, const Scalar* earTipMinusOne )
 	{
-		/*
-			http://www.blackpawn.com/texts/pointinpoly/default.html
-			Original equation
+		if( ( pointToCheck[ 0 ] == earTip[ 0 ] && pointToCheck[ 1 ] == earTip[ 1 ] ) ||
+			( pointToCheck[ 0 ] == earTipPlusOne[ 0 ] && pointToCheck[ 1 ] == earTipPlusOne[ 1 ] ) ||
+			( pointToCheck[ 0 ] == earTipMinusOne[ 0 ] && pointToCheck[ 1 ] == earTipMinusOne[ 1 ] ) )
+			return false; // ignore duplicates
 
-			P = A + u * ( C - A ) + v * ( B - A )
+		const Scalar* a = earTipMinusOne;
+		const Scalar* b = earTip;
+		const Scalar* c = earTipPlusOne;
 
-			->  ( P - A ) = u * ( C - A ) + c * ( B - A )
-			->  v2 = u * v0 + v1
+		// Which side of each edge (a->b, b->c, c->a) the point is on; >= 0 is left or on the edge
+		WideScalar ab = static_cast< WideScalar >( b[ 0 ] - a[ 0 ] ) * ( pointToCheck[ 1 ] - a[ 1 ] ) - static_cast< WideScalar >( b[ 1 ] - a[ 1 ] ) * ( pointToCheck[ 0 ] - a[ 0 ] );
+		WideScalar bc = static_cast< WideScalar >( c[ 0 ] - b[ 0 ] ) * ( pointToCheck[ 1 ] - b[ 1 ] ) - static_cast< WideScalar >( c[ 1 ] - b[ 1 ] ) * ( pointToCheck[ 0 ] - b[ 0 ] );
+		WideScalar ca = static_cast< WideScalar >( a[ 0 ] - c[ 0 ] ) * ( pointToCheck[ 1 ] - c[ 1 ] ) - static_cast< WideScalar >( a[ 1 ] - c[ 1 ] ) * ( pointToCheck[ 0 ] - c[ 0 ] );
+
+		return ( ab >= 0 ) && ( bc >= 0 ) && ( ca >= 0 );
+	}
 
-			->  v2 DOT v0 = ( u * v0 + v * v1 ) DOT v0
-			->  v2 DOT v1 = ( u * v0 + v * v1 ) DOT v1
+	//------------------------------------------------------------------------------------------
 
-			->  v2 DOT v0 = u * ( v0 DOT v0 ) + v * ( v1 DOT v0 )
-			->  v2 DOT v1 = u * ( v0 DOT v1 ) + v * ( v1 DOT v1 )
-		*/
+	/**
+	 * \brief Returns TRUE if any of the count points (given as separate x and y arrays) lies inside the ear.
+	 */
+	bool anyInTriangleScalar( const Scalar* xs, const Scalar* ys, unsigned count, const Scalar* earTip, const Scalar* earTipPlusOne, const Scalar* earTipMinusOne )
+	{
+		Scalar point[ 2 ];
 
-		if( ( pointToCheck.x == earTip.x && pointToCheck.y == earTip.y ) ||
-			( pointToCheck.x == earTipPlusOne.x && pointToCheck.y == earTipPlusOne.y ) ||
-			( pointToCheck.x == earTipMinusOne.x && pointToCheck.y == earTipMinusOne.y ) )
-			return false; // ignore duplicates
+		for( unsigned i = 0; i < count; i++ )
+		{
+			point[ 0 ] = xs[ i ];
+			point[ 1 ] = ys[ i ];
+
+			if( inTriangle( point, earTip, earTipPlusOne, earTipMinusOne ) )
+				return true;
+		}
+
+		return false;
+	}
+
+#ifdef EAR_CLIPPING_SSE2
+
+	/// Four points at a time. Any remainder is handled by the scalar kernel.
+	bool anyInTriangleSSE2( const Scalar* xs, const Scalar* ys, unsigned count, const Scalar* earTip, const Scalar* earTipPlusOne, const Scalar* earTipMinusOne )
+	{
+		const Scalar* a = earTipMinusOne;
+		const Scalar* b = earTip;
+		const Scalar* c = earTipPlusOne;
+
+		const __m128 ax = _mm_set1_ps( a[ 0 ] ), ay = _mm_set1_ps( a[ 1 ] );
+		const __m128 bx = _mm_set1_ps( b[ 0 ] ), by = _mm_set1_ps( b[ 1 ] );
+		const __m128 cx = _mm_set1_ps( c[ 0 ] ), cy = _mm_set1_ps( c[ 1 ] );
+
+		const __m128 abx = _mm_set1_ps( b[ 0 ] - a[ 0 ] ), aby = _mm_set1_ps( b[ 1 ] - a[ 1 ] );
+		const __m128 bcx = _mm_set1_ps( c[ 0 ] - b[ 0 ] ), bcy = _mm_set1_ps( c[ 1 ] - b[ 1 ] );
+		const __m128 cax = _mm_set1_ps( a[ 0 ] - c[ 0 ] ), cay = _mm_set1_ps( a[ 1 ] - c[ 1 ] );
+
+		const __m128 zero = _mm_setzero_ps( );
+
+		unsigned i = 0;
+
+		for( ; i + 4 <= count; i += 4 )
+		{
+			__m128 px = _mm_loadu_ps( xs + i );
+			__m128 py = _mm_loadu_ps( ys + i );
+
+			__m128 ab = _mm_sub_ps( _mm_mul_ps( abx, _mm_sub_ps( py, ay ) ), _mm_mul_ps( aby, _mm_sub_ps( px, ax ) ) );
+			__m128 bc = _mm_sub_ps( _mm_mul_ps( bcx, _mm_sub_ps( py, by ) ), _mm_mul_ps( bcy, _mm_sub_ps( px, bx ) ) );
+			__m128 ca = _mm_sub_ps( _mm_mul_ps( cax, _mm_sub_ps( py, cy ) ), _mm_mul_ps( cay, _mm_sub_ps( px, cx ) ) );
+
+			__m128 inside = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( ab, zero ), _mm_cmpge_ps( bc, zero ) ), _mm_cmpge_ps( ca, zero ) );
+
+			__m128 duplicate = _mm_or_ps( _mm_or_ps(
+				_mm_and_ps( _mm_cmpeq_ps( px, ax ), _mm_cmpeq_ps( py, ay ) ),
+				_mm_and_ps( _mm_cmpeq_ps( px, bx ), _mm_cmpeq_ps( py, by ) ) ),
+				_mm_and_ps( _mm_cmpeq_ps( px, cx ), _mm_cmpeq_ps( py, cy ) ) );
+
+			if( _mm_movemask_ps( _mm_andnot_ps( duplicate, inside ) ) != 0 )
+				return true;
+		}
+
+		return anyInTriangleScalar( xs + i, ys + i, count - i, earTip, earTipPlusOne, earTipMinusOne );
+	}
+
+#endif
+
+#ifdef EAR_CLIPPING_AVX2
+
+	/// Eight points at a time. Any remainder is handled by the SSE2 kernel.
+#if defined( __GNUC__ )
+	__attribute__( ( target( "avx2" ) ) )
+#endif
+	bool anyInTriangleAVX2( const Scalar* xs, const Scalar* ys, unsigned count, const Scalar* earTip, const Scalar* earTipPlusOne, const Scalar* earTipMinusOne )
+	{
+		const Scalar* a = earTipMinusOne;
+		const Scalar* b = earTip;
+		const Scalar* c = earTipPlusOne;
+
+		const __m256 ax = _mm256_set1_ps( a[ 0 ] ), ay = _mm256_set1_ps( a[ 1 ] );
+		const __m256 bx = _mm256_set1_ps( b[ 0 ] ), by = _mm256_set1_ps( b[ 1 ] );
+		const __m256 cx = _mm256_set1_ps( c[ 0 ] ), cy = _mm256_set1_ps( c[ 1 ] );
+
+		const __m256 abx = _mm256_set1_ps( b[ 0 ] - a[ 0 ] ), aby = _mm256_set1_ps( b[ 1 ] - a[ 1 ] );
+		const __m256 bcx = _mm256_set1_ps( c[ 0 ] - b[ 0 ] ), bcy = _mm256_set1_ps( c[ 1 ] - b[ 1 ] );
+		const __m256 cax = _mm256_set1_ps( a[ 0 ] - c[ 0 ] ), cay = _mm256_set1_ps( a[ 1 ] - c[ 1 ] );
 
-		Vector v0 = Vector( ( earTipMinusOne.x - earTip.x ), ( earTipMinusOne.y - earTip.y ) );
-		Vector v1 = Vector( ( earTipPlusOne.x - earTip.x ), ( earTipPlusOne.y - earTip.y ) );
-		Vector v2 = Vector( ( pointToCheck.x - earTip.x ), ( pointToCheck.y - earTip.y ) );
+		const __m256 zero = _mm256_setzero_ps( );
 
-		float u = ( v1.dot( v1 ) * v2.dot( v0 ) - v1.dot( v0 ) * v2.dot( v1 ) ) / ( v0.dot( v0 ) * v1.dot( v1 ) - v0.dot( v1 ) * v1.dot( v0 ) );
-		float v = ( v0.dot( v0 ) * v2.dot( v1 ) - v0.dot( v1 ) * v2.dot( v0 ) ) / ( v0.dot( v0 ) * v1.dot( v1 ) - v0.dot( v1 ) * v1.dot( v0 ) );
+		unsigned i = 0;
 
-		// u OR v < 0 = wrong direction from triangle and thus outside
-		// u OR v > 1 = went past triangle and thus outside
-		// u  + v > 1  = crossed diagonal of Vi+1 and Vi-1 and thus outside
-		if( u < 0 || v < 0 || u > 1 || v > 1 || ( u + v ) > 1 )
+		for( ; i + 8 <= count; i += 8 )
+		{
+			__m256 px = _mm256_loadu_ps( xs + i );
+			__m256 py = _mm256_loadu_ps( ys + i );
+
+			__m256 ab = _mm256_sub_ps( _mm256_mul_ps( abx, _mm256_sub_ps( py, ay ) ), _mm256_mul_ps( aby, _mm256_sub_ps( px, ax ) ) );
+			__m256 bc = _mm256_sub_ps( _mm256_mul_ps( bcx, _mm256_sub_ps( py, by ) ), _mm256_mul_ps( bcy, _mm256_sub_ps( px, bx ) ) );
+			__m256 ca = _mm256_sub_ps( _mm256_mul_ps( cax, _mm256_sub_ps( py, cy ) ), _mm256_mul_ps( cay, _mm256_sub_ps( px, cx ) ) );
+
+			__m256 inside = _mm256_and_ps( _mm256_and_ps( _mm256_cmp_ps( ab, zero, _CMP_GE_OQ ), _mm256_cmp_ps( bc, zero, _CMP_GE_OQ ) ), _mm256_cmp_ps( ca, zero, _CMP_GE_OQ ) );
+
+			__m256 duplicate = _mm256_or_ps( _mm256_or_ps(
+				_mm256_and_ps( _mm256_cmp_ps( px, ax, _CMP_EQ_OQ ), _mm256_cmp_ps( py, ay, _CMP_EQ_OQ ) ),
+				_mm256_and_ps( _mm256_cmp_ps( px, bx, _CMP_EQ_OQ ), _mm256_cmp_ps( py, by, _CMP_EQ_OQ ) ) ),
+				_mm256_and_ps( _mm256_cmp_ps( px, cx, _CMP_EQ_OQ ), _mm256_cmp_ps( py, cy, _CMP_EQ_OQ ) ) );
+
+			if( _mm256_movemask_ps( _mm256_andnot_ps( duplicate, inside ) ) != 0 )
+				return true;
+		}
+
+		return anyInTriangleSSE2( xs + i, ys + i, count - i, earTip, earTipPlusOne, earTipMinusOne );
+	}
+
+	bool supportsAVX2( )
+	{
+#if defined( _MSC_VER )
+		int info[ 4 ];
+
+		__cpuid( info, 0 );
+
+		if( info[ 0 ] < 7 )
 			return false;
 
-		return true;
+		// OS must save the YMM registers (OSXSAVE + AVX, then XCR0)
+		__cpuid( info, 1 );
+
+		if( ( info[ 2 ] & ( 1 << 27 ) ) == 0 || ( info[ 2 ] & ( 1 << 28 ) ) == 0 || ( _xgetbv( 0 ) & 6 ) != 6 )
+			return false;
+
+		__cpuidex( info, 7, 0 );
+
+		return ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+#else
+		__builtin_cpu_init( );
+		return __builtin_cpu_supports( "avx2" ) != 0;
+#endif
+	}
+
+#endif
+
+	//------------------------------------------------------------------------------------------
+
+	typedef bool ( *ContainmentKernel )( const Scalar*, const Scalar*, unsigned, const Scalar*, const Scalar*, const Scalar* );
+
+	/// Picks the widest containment kernel the CPU supports
+	ContainmentKernel selectKernel( )
+	{
+#if defined( EAR_CLIPPING_AVX2 )
+		if( supportsAVX2( ) )
+			return anyInTriangleAVX2;
+#endif
+#if defined( EAR_CLIPPING_SSE2 )
+		return anyInTriangleSSE2;
+#else
+		return anyInTriangleScalar;
+#endif
 	}
 
+	const ContainmentKernel anyInTriangle = selectKernel( );
+
 	//------------------------------------------------------------------------------------------
 	//------------------------------------------------------------------------------------------
 
-	bool isConvex( Point* active )
+	/**
+	 * \brief Working state of the triangulator.
+	 *
+	 * The triangulator never touches the Polygon it was handed. Instead the points are copied
+	 * once into the vertex array and the ring is tracked by index, so clipping an ear is a
+	 * matter of relinking two entries.
+	 */
+	struct EarRing
 	{
-		Point a = *active->previous;
-		Point b = *active;
-		Point c = *active->next;
+		const Scalar* vertices;
+
+		std::vector< uint32_t > next;
+		std::vector< uint32_t > previous;
+
+		/// All points that are currently not convex. Only these can ever lie inside an ear.
+		std::vector< uint32_t > reflex;
+
+		/// Coordinates of the reflex points, in the same order, for the containment kernels
+		std::vector< Scalar > reflexX;
+		std::vector< Scalar > reflexY;
+
+		/// Position of each point within reflex, or NOT_REFLEX
+		std::vector< uint32_t > reflexSlot;
+
+		/// Cached ear status of each point. Cleared once the point has been clipped.
+		std::vector< char > ear;
+
+		/**
+		 * Points in the order they were found to be ears. A point is only appended when its
+		 * status flips to ear, so entries whose status was lost since are simply skipped.
+		 */
+		std::vector< uint32_t > ears;
+
+		/// Morton code of each point. Empty unless the z-order index is in use.
+		std::vector< uint32_t > z;
+
+		/// Points linked in order of increasing Morton code
+		std::vector< uint32_t > nextZ;
+		std::vector< uint32_t > previousZ;
+
+		/// Maps coordinates onto the 15-bit grid the Morton codes are built from
+		double minX, minY, invSize;
+
+		static const uint32_t NOT_REFLEX = 0xFFFFFFFF;
+		static const uint32_t NO_POINT = 0xFFFFFFFF;
+
+		const Scalar* point( uint32_t index ) const { return vertices + ( index * 2 ); }
+
+		bool isReflex( uint32_t index ) const { return reflexSlot[ index ] != NOT_REFLEX; }
+
+		void addReflex( uint32_t index )
+		{
+			reflexSlot[ index ] = reflex.size( );
+			reflex.push_back( index );
+
+			reflexX.push_back( point( index )[ 0 ] );
+			reflexY.push_back( point( index )[ 1 ] );
+		}
+
+		/// Swaps the last reflex point into the slot of the removed one
+		void removeReflex( uint32_t index )
+		{
+			uint32_t slot = reflexSlot[ index ];
+
+			reflex[ slot ] = reflex.back( );
+			reflexX[ slot ] = reflexX.back( );
+			reflexY[ slot ] = reflexY.back( );
+			reflexSlot[ reflex[ slot ] ] = slot;
+
+			reflex.pop_back( );
+			reflexX.pop_back( );
+			reflexY.pop_back( );
+			reflexSlot[ index ] = NOT_REFLEX;
+		}
+	};
+
+	const uint32_t EarRing::NOT_REFLEX;
+	const uint32_t EarRing::NO_POINT;
+
+	//------------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Interleaves the bits of the grid coordinates of the point into its Morton code.
+	 * source: http://graphics.stanford.edu/~seander/bithacks.html#InterleaveBMN
+	 */
+	uint32_t zOrder( const EarRing &ring, Scalar x, Scalar y )
+	{
+		uint32_t zx = static_cast< uint32_t >( ( x - ring.minX ) * ring.invSize );
+		uint32_t zy = static_cast< uint32_t >( ( y - ring.minY ) * ring.invSize );
+
+		zx = ( zx | ( zx << 8 ) ) & 0x00FF00FF;
+		zx = ( zx | ( zx << 4 ) ) & 0x0F0F0F0F;
+		zx = ( zx | ( zx << 2 ) ) & 0x33333333;
+		zx = ( zx | ( zx << 1 ) ) & 0x55555555;
+
+		zy = ( zy | ( zy << 8 ) ) & 0x00FF00FF;
+		zy = ( zy | ( zy << 4 ) ) & 0x0F0F0F0F;
+		zy = ( zy | ( zy << 2 ) ) & 0x33333333;
+		zy = ( zy | ( zy << 1 ) ) & 0x55555555;
+
+		return zx | ( zy << 1 );
+	}
+
+	/**
+	 * \brief Builds the z-order index: a Morton code per point and a list sorted by it.
+	 */
+	void indexCurve( EarRing &ring, unsigned numPoints )
+	{
+		Scalar minX = ring.vertices[ 0 ];
+		Scalar minY = ring.vertices[ 1 ];
+		Scalar maxX = minX;
+		Scalar maxY = minY;
+
+		for( unsigned i = 1; i < numPoints; i++ )
+		{
+			minX = std::min( minX, ring.vertices[ ( i * 2 ) + 0 ] );
+			minY = std::min( minY, ring.vertices[ ( i * 2 ) + 1 ] );
+			maxX = std::max( maxX, ring.vertices[ ( i * 2 ) + 0 ] );
+			maxY = std::max( maxY, ring.vertices[ ( i * 2 ) + 1 ] );
+		}
+
+		ring.minX = minX;
+		ring.minY = minY;
+
+		double size = std::max( static_cast< double >( maxX ) - minX, static_cast< double >( maxY ) - minY );
+
+		ring.invSize = size > 0 ? ( 32767.0 / size ) : 0.0;
+
+		//--------------------------------------------
+
+		std::vector< std::pair< uint32_t, uint32_t > > sorted( numPoints );		// z, point
+
+		ring.z.resize( numPoints );
+		ring.nextZ.resize( numPoints );
+		ring.previousZ.resize( numPoints );
+
+		for( uint32_t i = 0; i < numPoints; i++ )
+		{
+			ring.z[ i ] = zOrder( ring, ring.vertices[ i * 2 ], ring.vertices[ ( i * 2 ) + 1 ] );
+			sorted[ i ] = std::make_pair( ring.z[ i ], i );
+		}
+
+		std::sort( sorted.begin( ), sorted.end( ) );
+
+		for( unsigned i = 0; i < numPoints; i++ )
+		{
+			ring.previousZ[ sorted[ i ].second ] = i > 0 ? sorted[ i - 1 ].second : EarRing::NO_POINT;
+			ring.nextZ[ sorted[ i ].second ] = i + 1 < numPoints ? sorted[ i + 1 ].second : EarRing::NO_POINT;
+		}
+	}
+
+	//------------------------------------------------------------------------------------------
+
+	bool isConvex( const EarRing &ring, uint32_t active )
+	{
+		const Scalar* a = ring.point( ring.previous[ active ] );
+		const Scalar* b = ring.point( active );
+		const Scalar* c = ring.point( ring.next[ active ] );
 
 		// a  = c->next; b = c->previous
 		// testing what side of the diagonal ac that b is on
@@ -85,112 +406,517 @@ namespace EarClipping
 		//return ( b.x - a.x ) * ( c.y - a.y ) - ( b.y - a.y ) * ( c.x - a.x ) > 0;
 
 		// If sign of area is '-', then angle is convex
-		return ( ( a.x * ( c.y - b.y ) ) + ( b.x * ( a.y - c.y ) ) + ( c.x * ( b.y - a.y ) ) ) < 0;
+		return ( ( static_cast< WideScalar >( a[ 0 ] ) * ( c[ 1 ] - b[ 1 ] ) ) +
+		         ( static_cast< WideScalar >( b[ 0 ] ) * ( a[ 1 ] - c[ 1 ] ) ) +
+		         ( static_cast< WideScalar >( c[ 0 ] ) * ( b[ 1 ] - a[ 1 ] ) ) ) < 0;
 	}
 
 	//------------------------------------------------------------------------------------------
 	//------------------------------------------------------------------------------------------
 
+	/**
+	 * \brief Re-evaluates whether the point is convex and keeps the reflex set in step.
+	 */
+	void updateReflex( EarRing &ring, uint32_t active )
+	{
+		bool convex = isConvex( ring, active );
+
+		if( convex && ring.isReflex( active ) )
+			ring.removeReflex( active );
+		else if( !convex && !ring.isReflex( active ) )
+			ring.addReflex( active );
+	}
+
+	//------------------------------------------------------------------------------------------
+
 	/** 
 	 * \brief Check if any other points are inside the prospective ear
+	 *
+	 * A convex point can only lie inside the ear if some reflex point does as well,
+	 * so only the reflex set needs to be checked. The neighbours of the tip may be part of
+	 * the set, but as they match corners of the ear they are ignored by the kernel.
+	 */
+	bool isEar( const EarRing &ring, uint32_t active )
+	{
+		if( ring.reflex.empty( ) )
+			return true;
+
+		return !anyInTriangle( &ring.reflexX[ 0 ], &ring.reflexY[ 0 ], ring.reflex.size( ),
+			ring.point( active ), ring.point( ring.next[ active ] ), ring.point( ring.previous[ active ] ) );
+	}
+
+	/**
+	 * \brief isEar for indexed rings; only visits points whose Morton code falls within that of the ear's bounds.
+	 *
+	 * Every point inside the bounding box of the ear has a code between the codes of the
+	 * box's corners, so the z-ordered list is walked outwards from the tip in both directions
+	 * until the codes leave that range.
 	 */
-	bool isEar( Point* active )
+	bool isEarIndexed( const EarRing &ring, uint32_t active )
 	{
-		Point* checker = active->next->next;
+		uint32_t next = ring.next[ active ];
+		uint32_t previous = ring.previous[ active ];
 
-		// Check every point not part of the ear
-		while( checker != active->previous )
+		const Scalar* a = ring.point( previous );
+		const Scalar* b = ring.point( active );
+		const Scalar* c = ring.point( next );
+
+		uint32_t minZ = zOrder( ring, std::min( a[ 0 ], std::min( b[ 0 ], c[ 0 ] ) ), std::min( a[ 1 ], std::min( b[ 1 ], c[ 1 ] ) ) );
+		uint32_t maxZ = zOrder( ring, std::max( a[ 0 ], std::max( b[ 0 ], c[ 0 ] ) ), std::max( a[ 1 ], std::max( b[ 1 ], c[ 1 ] ) ) );
+
+		uint32_t checker = ring.nextZ[ active ];
+
+		while( checker != EarRing::NO_POINT && ring.z[ checker ] <= maxZ )
 		{
-			if( inTriangle( *checker, *active, *active->next, *active->previous ) )
-			{
+			if( checker != previous && checker != next && ring.isReflex( checker ) &&
+				inTriangle( ring.point( checker ), b, c, a ) )
 				return false;
-			}
 
-			checker = checker->next;
+			checker = ring.nextZ[ checker ];
+		}
+
+		checker = ring.previousZ[ active ];
+
+		while( checker != EarRing::NO_POINT && ring.z[ checker ] >= minZ )
+		{
+			if( checker != previous && checker != next && ring.isReflex( checker ) &&
+				inTriangle( ring.point( checker ), b, c, a ) )
+				return false;
+
+			checker = ring.previousZ[ checker ];
 		}
 
 		return true;
 	}
 
+	//------------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Re-evaluates the cached convex and ear status of the point.
+	 *
+	 * Clipping an ear only changes the triangles formed by its two neighbours, so these
+	 * are the only points that ever need to be passed in after the initial pass.
+	 */
+	void updateEar( EarRing &ring, uint32_t active )
+	{
+		updateReflex( ring, active );
+
+		bool ear = !ring.isReflex( active ) && ( ring.z.empty( ) ? isEar( ring, active ) : isEarIndexed( ring, active ) );
+
+		if( ear && !ring.ear[ active ] )
+			ring.ears.push_back( active );
+
+		ring.ear[ active ] = ear;
+	}
+
+	//------------------------------------------------------------------------------------------
 	//------------------------------------------------------------------------------------------
 	//------------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Hands the ears found by streamEars to its sink, a batch at a time.
+	 */
+	struct EarStream
+	{
+		EarSink* sink;
+		unsigned batchSize;
+
+		/// Passes every ear in indices on to the sink and empties it
+		void deliver( std::vector< uint32_t > &indices )
+		{
+			for( size_t first = 0; first < indices.size( ); first += batchSize * 3 )
+				sink->receiveEars( &indices[ first ], static_cast< unsigned >( std::min< size_t >( batchSize * 3, indices.size( ) - first ) / 3 ) );
+
+			indices.clear( );
+		}
+	};
+
 	//------------------------------------------------------------------------------------------
 
-	bool verifyEarCount( unsigned count, const char* path )
+	/**
+	 * \brief Clips the ears of the ring formed by the points in vertices, in order.
+	 *
+	 * If stream is given, each batch of ears is delivered as soon as it is complete and the
+	 * indices are emptied, so only one batch is held at a time.
+	 */
+	unsigned clipEars( const std::vector< Scalar > &vertices, std::vector< uint32_t > &indices, const TriangulationSettings &settings, EarStream* stream )
 	{
-		std::ifstream file( path );
+		unsigned numPoints = vertices.size( ) / 2;
+		unsigned numEars = 0;
+
+		indices.reserve( stream != NULL ? stream->batchSize * 3 : ( numPoints - 2 ) * 3 );
+
+		//--------------------------------------------
+		// Link the points up by index
+
+		EarRing ring;
 
-		if( file.is_open( ) )
+		ring.next.resize( numPoints );
+		ring.previous.resize( numPoints );
+		ring.reflexSlot.resize( numPoints, EarRing::NOT_REFLEX );
+		ring.ear.resize( numPoints, false );
+
+		for( unsigned i = 0; i < numPoints; i++ )
 		{
-			std::string hold;
-			unsigned cnt = 0;
+			ring.next[ i ] = ( i + 1 ) % numPoints;
+			ring.previous[ i ] = ( i + numPoints - 1 ) % numPoints;
+		}
+
+		ring.vertices = &vertices[ 0 ];
 
-			while( file.good( ) )
+		for( uint32_t i = 0; i < numPoints; i++ )
+		{
+			if( !isConvex( ring, i ) )
+				ring.addReflex( i );
+		}
+
+		if( settings.zOrderThreshold != 0 && numPoints >= settings.zOrderThreshold )
+			indexCurve( ring, numPoints );
+
+		// Reflex set must be complete before any ear test is run
+		for( uint32_t i = 0; i < numPoints; i++ )
+			updateEar( ring, i );
+
+		//--------------------------------------------
+
+		uint32_t active;
+		uint32_t next;
+		uint32_t previous;
+
+		unsigned remaining = numPoints;
+
+		// Running out of ears before the ring is down to its last triangle means the
+		// remaining points are degenerate (collinear or self-intersecting).
+		for( unsigned i = 0; ( i < ring.ears.size( ) ) && ( remaining >= 3 ); i++ )
+		{
+			active = ring.ears[ i ];
+
+			if( !ring.ear[ active ] )
+				continue; // lost its ear status since it was listed
+
+			next = ring.next[ active ];
+			previous = ring.previous[ active ];
+
+			indices.push_back( previous );
+			indices.push_back( active );
+			indices.push_back( next );
+
+			numEars++;
+
+			if( stream != NULL && indices.size( ) >= stream->batchSize * 3 )
+				stream->deliver( indices );
+
+			// remove ear tip (active) from the ring
+			ring.next[ previous ] = next;
+			ring.previous[ next ] = previous;
+			ring.ear[ active ] = false;
+
+			if( !ring.z.empty( ) )
 			{
-				std::getline( file, hold );
-				cnt++;
+				if( ring.previousZ[ active ] != EarRing::NO_POINT )
+					ring.nextZ[ ring.previousZ[ active ] ] = ring.nextZ[ active ];
+
+				if( ring.nextZ[ active ] != EarRing::NO_POINT )
+					ring.previousZ[ ring.nextZ[ active ] ] = ring.previousZ[ active ];
 			}
 
-			file.close( );
+			remaining--;
 
-			if( cnt - 2 == count )
-				return true;
+			// only the neighbours of the tip have a new triangle
+			updateEar( ring, previous );
+			updateEar( ring, next );
 		}
 
-		return false;
+		return numEars;
 	}
 
 	//------------------------------------------------------------------------------------------
 
-	bool recordEars( Polygon poly, const char* path )
+	/**
+	 * \brief Returns true if the points in vertices form a strictly convex, counter-clockwise ring.
+	 *
+	 * Every corner has to turn left, and the edges may only change between heading left and
+	 * heading right twice; the second test rejects rings that wind around more than once.
+	 */
+	bool isConvexRing( const std::vector< Scalar > &vertices )
 	{
-		std::ofstream file( path );
+		unsigned numPoints = vertices.size( ) / 2;
+		unsigned changes = 0;
 
-		if( !file.is_open( ) )
-			return false; //failed to open file
+		int first = 0;
+		int heading = 0;
 
-		//--------------------------------------------
+		for( unsigned i = 0; i < numPoints; i++ )
+		{
+			const Scalar* a = &vertices[ i * 2 ];
+			const Scalar* b = &vertices[ ( ( i + 1 ) % numPoints ) * 2 ];
+			const Scalar* c = &vertices[ ( ( i + 2 ) % numPoints ) * 2 ];
 
-		bool earFound; // will need to prove this false
+			WideScalar turn = ( static_cast< WideScalar >( b[ 0 ] ) - a[ 0 ] ) * ( static_cast< WideScalar >( c[ 1 ] ) - b[ 1 ] ) -
+			                  ( static_cast< WideScalar >( b[ 1 ] ) - a[ 1 ] ) * ( static_cast< WideScalar >( c[ 0 ] ) - b[ 0 ] );
 
-		Point* active = poly.get( );
+			if( turn <= 0 )
+				return false;
 
-		unsigned numPoints = poly.numPoints( ) - 2;
+			int direction = ( b[ 0 ] > a[ 0 ] ) - ( b[ 0 ] < a[ 0 ] );
+
+			if( direction == 0 )
+				continue; // vertical edge
+
+			if( first == 0 )
+				first = direction;
+			else if( direction != heading )
+				changes++;
+
+			heading = direction;
+		}
+
+		if( heading != first )
+			changes++;
+
+		return changes <= 2;
+	}
+
+	/**
+	 * \brief Emits the triangle fan around the first point of a convex ring of numPoints points.
+	 */
+	unsigned fanEars( unsigned numPoints, std::vector< uint32_t > &indices )
+	{
+		indices.reserve( ( numPoints - 2 ) * 3 );
+
+		for( uint32_t i = 1; i + 1 < numPoints; i++ )
+		{
+			indices.push_back( 0 );
+			indices.push_back( i );
+			indices.push_back( i + 1 );
+		}
+
+		return numPoints - 2;
+	}
+
+	/**
+	 * \brief Picks the cheapest way to triangulate the ring formed by the points in vertices.
+	 *
+	 * Only ear clipping delivers ears to the stream as it goes; the other methods leave all
+	 * of their ears in indices.
+	 */
+	unsigned triangulateVertices( const std::vector< Scalar > &vertices, std::vector< uint32_t > &indices, const TriangulationSettings &settings,
+		                          EarStream* stream = NULL )
+	{
+		unsigned numPoints = vertices.size( ) / 2;
+
+		// Tiny rings are clipped on the stack by a kernel unrolled for their size
+		if( numPoints <= SMALL_POLYGON_MAX_POINTS )
+		{
+			indices.resize( ( numPoints - 2 ) * 3 );
+			indices.resize( triangulateSmall( &vertices[ 0 ], numPoints, &indices[ 0 ] ) * 3 );
+
+			return indices.size( ) / 3;
+		}
+
+		// Every diagonal from the first point of a convex ring lies inside it, so no ear search is needed
+		if( isConvexRing( vertices ) )
+			return fanEars( numPoints, indices );
+
+		if( settings.method == METHOD_MONOTONE )
+		{
+			unsigned triangles = triangulateMonotone( vertices, std::vector< uint32_t >( 1, 0 ), indices );
+
+			// The sweep gives up on self-intersecting input; ear clipping gets as far as it can
+			if( triangles > 0 )
+				return triangles;
+		}
+
+		return clipEars( vertices, indices, settings, stream );
+	}
+
+	//------------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Copies the points of the polygon into vertices as X,Y pairs, starting at the head.
+	 */
+	void copyPoints( const Polygon &poly, std::vector< Scalar > &vertices )
+	{
+		unsigned numPoints = poly.numPoints( );
+
+		vertices.reserve( numPoints * 2 );
+
+		Point* point = poly.get( );
+
+		for( unsigned i = 0; i < numPoints; i++ )
+		{
+			vertices.push_back( point->x );
+			vertices.push_back( point->y );
+
+			point = point->next;
+		}
+	}
+
+	unsigned triangulate( const Polygon &poly, std::vector< Scalar > &vertices, std::vector< uint32_t > &indices,
+		                  const TriangulationSettings &settings )
+	{
+		vertices.clear( );
+		indices.clear( );
+
+		if( poly.numPoints( ) < 3 )
+			return 0;
+
+		// Copy the points into the vertex array; the ring is tracked by index from here on
+		copyPoints( poly, vertices );
+
+		return triangulateVertices( vertices, indices, settings );
+	}
+
+	//------------------------------------------------------------------------------------------
+
+	unsigned streamEars( const Polygon &poly, EarSink &sink, unsigned batchSize, const TriangulationSettings &settings )
+	{
+		if( poly.numPoints( ) < 3 )
+			return 0;
+
+		std::vector< Scalar > vertices;
+		std::vector< uint32_t > indices;
+
+		copyPoints( poly, vertices );
+
+		EarStream stream;
+		stream.sink = &sink;
+		stream.batchSize = std::max( batchSize, 1u );
+
+		sink.beginEars( &vertices[ 0 ], poly.numPoints( ) );
+
+		unsigned numEars = triangulateVertices( vertices, indices, settings, &stream );
+
+		// Whatever is left: the last partial batch, or every ear if ear clipping was not used
+		stream.deliver( indices );
+
+		return numEars;
+	}
+
+	//------------------------------------------------------------------------------------------
+
+	unsigned triangulateIndexed( Polygon &poly, std::vector< Scalar > &vertices, std::vector< uint32_t > &indices,
+		                         BridgeMode mode, const TriangulationSettings &settings )
+	{
+		vertices.clear( );
+		indices.clear( );
 
 		//--------------------------------------------
+		// Source vertices: the polygon, then each hole, before any bridges are added
 
-		// if all goes well, there will be n-2 ears (n=number of vertices)
-		// let the user (or retrieveEars) know how many ears to expect
-		file << poly.numPoints( ) - 2 << "\n";
+		copyPoints( poly, vertices );
+
+		for( unsigned i = 0; i < poly.numChildren( ); i++ )
+			copyPoints( *poly.getChild( i ), vertices );
+
+		uint32_t numVertices = static_cast< uint32_t >( vertices.size( ) / 2 );
+
+		std::unordered_map< std::pair< Scalar, Scalar >, uint32_t, CoordinateHash > source;
+		source.reserve( numVertices );
+
+		// Points repeated in the input keep their first index
+		for( uint32_t i = 0; i < numVertices; i++ )
+			source.insert( std::make_pair( std::make_pair( vertices[ i * 2 ], vertices[ i * 2 + 1 ] ), i ) );
 
 		//--------------------------------------------
 
-		while( poly.numPoints( ) >= 3 )
+		if( poly.numChildren( ) > 0 )
+			mergePolygon( poly, mode );
+
+		std::vector< Scalar > merged;
+		unsigned numEars = triangulate( poly, merged, indices, settings );
+
+		// Bridge points are copies of source points, so every merged point has the position of one
+		std::vector< uint32_t > remap( merged.size( ) / 2 );
+
+		for( uint32_t i = 0; i < remap.size( ); i++ )
 		{
-			earFound = true;
+			std::unordered_map< std::pair< Scalar, Scalar >, uint32_t, CoordinateHash >::const_iterator found =
+				source.find( std::make_pair( merged[ i * 2 ], merged[ i * 2 + 1 ] ) );
 
-			if( isConvex( active ) )
+			if( found != source.end( ) )
 			{
-				if( isEar( active ) )
-				{
-					// handle ear
-					file << active->previous->x << "," << active->previous->y << ":" << active->x << "," << active->y << ":" << active->next->x << "," << active->next->y << "\n";
-					file.flush( );
-
-					// remove ear tip (active) from the polygon)
-					active = active->next;
-					poly.removePoint( *active->previous );
-
-					continue;
-				}
+				remap[ i ] = found->second;
+				continue;
 			}
 
-			active = active->next;
+			// Only a point that does not equal itself (NaN) can be missed; it is kept as a new vertex
+			remap[ i ] = static_cast< uint32_t >( vertices.size( ) / 2 );
+
+			vertices.push_back( merged[ i * 2 ] );
+			vertices.push_back( merged[ i * 2 + 1 ] );
+		}
+
+		for( size_t i = 0; i < indices.size( ); i++ )
+			indices[ i ] = remap[ indices[ i ] ];
+
+		return numEars;
+	}
+
+	unsigned triangulateIndexed( Polygon &poly, std::vector< Scalar > &vertices, std::vector< uint16_t > &indices,
+		                         BridgeMode mode, const TriangulationSettings &settings )
+	{
+		indices.clear( );
+
+		unsigned numPoints = poly.numPoints( );
+
+		for( unsigned i = 0; i < poly.numChildren( ); i++ )
+			numPoints += poly.getChild( i )->numPoints( );
+
+		if( numPoints > 0xFFFF + 1 )
+		{
+			vertices.clear( );
+			return 0;
+		}
+
+		std::vector< uint32_t > wide;
+		unsigned numEars = triangulateIndexed( poly, vertices, wide, mode, settings );
+
+		indices.assign( wide.begin( ), wide.end( ) );
+
+		return numEars;
+	}
+
+	//------------------------------------------------------------------------------------------
+
+	bool recordEars( const Polygon &poly, const char* path, EarFileFormat format )
+	{
+		std::vector< Scalar > vertices;
+		std::vector< uint32_t > indices;
+
+		// Fewer than three points have no ears to record
+		if( poly.numPoints( ) < 3 )
+			return false;
+
+		unsigned numPoints = poly.numPoints( ) - 2;
+		unsigned numEars = triangulate( poly, vertices, indices );
+
+		if( format == EAR_FILE_BINARY )
+			return writeMesh( path, vertices, indices ) && numEars == numPoints;
+
+		//--------------------------------------------
+
+		EarWriter writer;
+
+		if( !writer.open( path ) )
+			return false; //failed to open file
+
+		// if all goes well, there will be n-2 ears (n=number of vertices)
+		// let the user (or retrieveEars) know how many ears to expect
+		writer.writeCount( numPoints );
+
+		//--------------------------------------------
+
+		for( unsigned i = 0; i < numEars; i++ )
+		{
+			writer.writeEar( &vertices[ indices[ ( i * 3 ) + 0 ] * 2 ],
+			                 &vertices[ indices[ ( i * 3 ) + 1 ] * 2 ],
+			                 &vertices[ indices[ ( i * 3 ) + 2 ] * 2 ] );
 		}
 
-		file.close( );
+		unsigned written = writer.numEars( );
 
-		return verifyEarCount( numPoints, path );
+		return writer.close( ) && written == numPoints;
 	}
 
 }
\ No newline at end of file
@@ -0,0 +1,251 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2018 Steven T Sell (ssell@vertexfragment.com)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "earClipping_Core.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+// Values are formatted with std::to_chars where the standard library has it, and snprintf otherwise
+#if ( __cplusplus >= 201703L ) || ( defined( _MSVC_LANG ) && _MSVC_LANG >= 201703L )
+#include <charconv>
+#endif
+
+//------------------------------------------------------------------------------------------
+
+namespace EarClipping
+{
+	/// Room kept free in the buffer for a single line: six values of at most 32 characters and their separators
+	const size_t EAR_LINE_SIZE = 6 * 32 + 8;
+
+	/**
+	 * \brief Everything shared between the writer and its writing thread.
+	 */
+	struct EarWriterState
+	{
+		std::FILE* file;
+
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable signal;
+
+		std::vector< char > buffers[ 2 ];
+		unsigned active;					// buffer being filled; the other is the one written
+
+		bool pending;						// the other buffer holds pendingSize bytes waiting to be written
+		size_t pendingSize;
+
+		bool closing;
+		bool failed;
+	};
+
+	//--------------------------------------------------------------------------------------
+
+	/**
+	 * \brief Body of the writing thread. Writes each buffer handed over until the writer closes.
+	 */
+	void runEarWriter( EarWriterState* state )
+	{
+		std::unique_lock< std::mutex > lock( state->mutex );
+
+		for( ;; )
+		{
+			while( !state->pending && !state->closing )
+				state->signal.wait( lock );
+
+			if( !state->pending )
+				break; // closing, and everything has been written
+
+			const char* data = &state->buffers[ state->active ^ 1 ][ 0 ];
+			size_t size = state->pendingSize;
+
+			lock.unlock( );
+			bool written = std::fwrite( data, 1, size, state->file ) == size;
+			lock.lock( );
+
+			if( !written )
+				state->failed = true;
+
+			state->pending = false;
+			state->signal.notify_all( );
+		}
+	}
+
+	/**
+	 * \brief Writes value at output, returning the end of the text written. There must be room for 32 characters.
+	 */
+	char* formatValue( char* output, Scalar value )
+	{
+#if defined( __cpp_lib_to_chars )
+		// Shortest text that reads back as the same value
+		return std::to_chars( output, output + 32, value ).ptr;
+#elif defined( EAR_CLIPPING_INT32 )
+		return output + std::snprintf( output, 32, "%d", value );
+#elif defined( EAR_CLIPPING_DOUBLE )
+		return output + std::snprintf( output, 32, "%.17g", value );
+#else
+		return output + std::snprintf( output, 32, "%.9g", value );
+#endif
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	EarWriter::EarWriter( size_t bufferSize )
+		: m_State( NULL ), m_Buffer( NULL ), m_BufferSize( std::max( bufferSize, EAR_LINE_SIZE * 2 ) ), m_Used( 0 ), m_NumEars( 0 )
+	{
+
+	}
+
+	EarWriter::~EarWriter( )
+	{
+		close( );
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	bool EarWriter::open( const char* path )
+	{
+		close( );
+
+		std::FILE* file = std::fopen( path, "wb" );
+
+		if( file == NULL )
+			return false;
+
+		// Whole buffers are handed to fwrite; there is nothing left for the stream to gather
+		std::setvbuf( file, NULL, _IONBF, 0 );
+
+		m_State = new EarWriterState( );
+		m_State->file = file;
+		m_State->active = 0;
+		m_State->pending = false;
+		m_State->pendingSize = 0;
+		m_State->closing = false;
+		m_State->failed = false;
+
+		m_State->buffers[ 0 ].resize( m_BufferSize );
+		m_State->buffers[ 1 ].resize( m_BufferSize );
+
+		m_Buffer = &m_State->buffers[ 0 ][ 0 ];
+		m_Used = 0;
+		m_NumEars = 0;
+
+		m_State->thread = std::thread( runEarWriter, m_State );
+
+		return true;
+	}
+
+	bool EarWriter::close( )
+	{
+		if( m_State == NULL )
+			return false;
+
+		{
+			std::unique_lock< std::mutex > lock( m_State->mutex );
+
+			while( m_State->pending )
+				m_State->signal.wait( lock );
+
+			if( m_Used > 0 )
+			{
+				m_State->pending = true;
+				m_State->pendingSize = m_Used;
+				m_State->active ^= 1;
+			}
+
+			m_State->closing = true;
+			m_State->signal.notify_all( );
+		}
+
+		m_State->thread.join( );
+
+		bool written = !m_State->failed && std::fflush( m_State->file ) == 0;
+		written = ( std::fclose( m_State->file ) == 0 ) && written;
+
+		delete m_State;
+
+		m_State = NULL;
+		m_Buffer = NULL;
+		m_Used = 0;
+
+		return written;
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	void EarWriter::reserve( )
+	{
+		if( m_BufferSize - m_Used >= EAR_LINE_SIZE )
+			return;
+
+		std::unique_lock< std::mutex > lock( m_State->mutex );
+
+		// Wait for the other buffer to be written before handing this one over
+		while( m_State->pending )
+			m_State->signal.wait( lock );
+
+		m_State->pending = true;
+		m_State->pendingSize = m_Used;
+		m_State->active ^= 1;
+		m_State->signal.notify_all( );
+
+		m_Buffer = &m_State->buffers[ m_State->active ][ 0 ];
+		m_Used = 0;
+	}
+
+	void EarWriter::writeCount( unsigned count )
+	{
+		if( m_State == NULL )
+			return;
+
+		reserve( );
+
+		int written = std::snprintf( m_Buffer + m_Used, EAR_LINE_SIZE, "%u\n", count );
+		m_Used += written;
+	}
+
+	void EarWriter::writeEar( const Scalar* a, const Scalar* b, const Scalar* c )
+	{
+		if( m_State == NULL )
+			return;
+
+		reserve( );
+
+		char* output = m_Buffer + m_Used;
+
+		output = formatValue( output, a[ 0 ] ); *output++ = ',';
+		output = formatValue( output, a[ 1 ] ); *output++ = ':';
+		output = formatValue( output, b[ 0 ] ); *output++ = ',';
+		output = formatValue( output, b[ 1 ] ); *output++ = ':';
+		output = formatValue( output, c[ 0 ] ); *output++ = ',';
+		output = formatValue( output, c[ 1 ] ); *output++ = '\n';
+
+		m_Used = output - m_Buffer;
+		m_NumEars++;
+	}
+};
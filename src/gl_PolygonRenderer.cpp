@@ -240,7 +240,7 @@ void PolygonRenderer::drawEars( )
 
 bool PolygonRenderer::performMerge( )
 {
-	EarClipping::orientatePolygon( &m_Polygon );
+	EarClipping::preprocessPolygon( &m_Polygon );
 
 	// Polygon has children
 	if( m_ActivePoint != -1 )
@@ -276,13 +276,22 @@ bool PolygonRenderer::triangulate( )
 		return false;
 	}
 
-	if( !EarClipping::recordEars( m_Polygon, "ears.txt" ) )
+	std::vector< EarClipping::Scalar > vertices;
+	std::vector< uint32_t > indices;
+
+	if( EarClipping::triangulate( m_Polygon, vertices, indices ) != m_Polygon.numPoints( ) - 2 )
 	{
 		std::cout << "Ear Clipping failed!" << std::endl;
 		return false;
 	}
 
-	m_Ears = EarClipping::retrieveEars( "ears.txt" );
+	m_Ears.clear( );
+
+	for( unsigned i = 0; i < indices.size( ); i++ )
+	{
+		m_Ears.push_back( static_cast< float >( vertices[ indices[ i ] * 2 ] ) );
+		m_Ears.push_back( static_cast< float >( vertices[ ( indices[ i ] * 2 ) + 1 ] ) );
+	}
 
 	return true;
 }
@@ -291,8 +300,11 @@ bool PolygonRenderer::triangulate( )
 
 void PolygonRenderer::reset( )
 {
-	EarClipping::Polygon newPolygon;
-	m_Polygon = newPolygon;
+	// The children were created here with new; the Polygon does not own them
+	while( m_Polygon.numChildren( ) != 0 )
+		m_Polygon.removeChild( m_Polygon.numChildren( ) - 1 );
+
+	m_Polygon = EarClipping::Polygon( );
 
 	m_Ears.clear( );
 
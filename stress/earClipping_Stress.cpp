@@ -0,0 +1,147 @@
+/**
+ * MIT License
+ * 
+ * Copyright (c) 2018 Steven T Sell (ssell@vertexfragment.com)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * Stress test for the merge and triangulation stages on million-point rings.
+ *
+ * A jagged outer ring of 1M points holding a jagged 1M-point hole is merged with both
+ * BRIDGE_CLOSEST and BRIDGE_RAY_CAST and the result triangulated. The ring sizes are deep
+ * enough that any per-point recursion would overflow the stack. Returns non-zero on failure.
+ *
+ * Build with projects/EarClippingStress.vcxproj, or for example:
+ *
+ *     g++ -std=c++11 -O2 -Isrc stress/earClipping_Stress.cpp src/earClipping_*.cpp -pthread
+ *
+ * The point counts may be given on the command line: stress [outer points] [hole points]
+ */
+
+#include "earClipping_Core.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+//------------------------------------------------------------------------------------------
+
+using namespace EarClipping;
+
+const double PI = 3.14159265358979323846;
+
+//------------------------------------------------------------------------------------------
+
+/**
+ * \brief Builds the outer ring (counter-clockwise) and its hole (clockwise), every other point pushed out a little.
+ */
+void buildPolygon( Polygon &poly, unsigned numOuter, unsigned numHole )
+{
+	for( unsigned i = 0; i < numOuter; i++ )
+	{
+		double angle = 2.0 * PI * i / numOuter;
+		double radius = 100.0 + ( ( i & 1 ) ? 0.5 : 0.0 );
+
+		poly.insertBefore( poly.get( ), Scalar( radius * cos( angle ) ), Scalar( radius * sin( angle ) ) );
+	}
+
+	Polygon* hole = new Polygon( &poly );
+
+	for( unsigned i = 0; i < numHole; i++ )
+	{
+		double angle = -2.0 * PI * i / numHole;
+		double radius = 50.0 + ( ( i & 1 ) ? 0.25 : 0.0 );
+
+		hole->insertBefore( hole->get( ), Scalar( 20.0 + radius * cos( angle ) ), Scalar( radius * sin( angle ) ) );
+	}
+}
+
+/**
+ * \brief Merges and triangulates the test polygon with the given bridge mode. Returns false on failure.
+ */
+bool runStress( BridgeMode mode, const char* name, unsigned numOuter, unsigned numHole )
+{
+	PointPool pool;
+	Polygon poly( NULL, &pool );
+
+	buildPolygon( poly, numOuter, numHole );
+
+	//--------------------------------------------
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now( );
+
+	mergePolygon( poly, mode );
+
+	double mergeTime = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now( ) - start ).count( );
+
+	// The hole and the two bridge points are added to the outer ring
+	unsigned expected = numOuter + numHole + 2;
+
+	if( poly.numPoints( ) != expected )
+	{
+		std::printf( "%s: merged into %u points, expected %u\n", name, poly.numPoints( ), expected );
+		delete poly.getChild( 0 );
+		return false;
+	}
+
+	//--------------------------------------------
+
+	std::vector< Scalar > vertices;
+	std::vector< uint32_t > indices;
+
+	TriangulationSettings settings;
+	settings.method = METHOD_MONOTONE;
+
+	start = std::chrono::steady_clock::now( );
+
+	unsigned numEars = triangulate( poly, vertices, indices, settings );
+
+	double triangulateTime = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now( ) - start ).count( );
+
+	delete poly.getChild( 0 );
+
+	std::printf( "%s: merged %u points in %.1fms, %u ears in %.1fms\n", name, expected, mergeTime, numEars, triangulateTime );
+
+	if( numEars != expected - 2 )
+	{
+		std::printf( "%s: found %u ears, expected %u\n", name, numEars, expected - 2 );
+		return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------------------
+
+int main( int argc, char** argv )
+{
+	unsigned numOuter = argc > 1 ? static_cast< unsigned >( std::atoi( argv[ 1 ] ) ) : 1000000;
+	unsigned numHole = argc > 2 ? static_cast< unsigned >( std::atoi( argv[ 2 ] ) ) : 1000000;
+
+	bool passed = runStress( BRIDGE_CLOSEST, "BRIDGE_CLOSEST", numOuter, numHole );
+	passed = runStress( BRIDGE_RAY_CAST, "BRIDGE_RAY_CAST", numOuter, numHole ) && passed;
+
+	std::printf( passed ? "passed\n" : "FAILED\n" );
+
+	return passed ? 0 : 1;
+}